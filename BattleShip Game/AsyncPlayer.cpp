@@ -0,0 +1,221 @@
+#include "AsyncPlayer.h"
+#include "Player.h"
+
+using namespace std;
+
+//*********************************************************************
+//  GamePool
+//*********************************************************************
+
+  // A fire-and-forget coroutine: it starts eagerly, frees its own frame
+  // when done, and tells the pool it has finished.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() { return Detached(); }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+
+    static Detached run(GamePool* pool, Task<void> t)
+    {
+        co_await pool->schedule();
+        co_await move(t);
+        pool->taskFinished();
+    }
+};
+
+GamePool::GamePool(int nThreads)
+ : m_live(0), m_stopping(false)
+{
+    if (nThreads <= 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+    for (int i = 0; i < nThreads; i++)
+        m_threads.emplace_back(&GamePool::workerLoop, this);
+}
+
+GamePool::~GamePool()
+{
+    waitIdle();
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work.notify_all();
+    for (thread& t : m_threads)
+        t.join();
+}
+
+void GamePool::spawn(Task<void> t)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_live++;
+    }
+    Detached::run(this, move(t));
+}
+
+void GamePool::post(coroutine_handle<> h)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_queue.push_back(h);
+    }
+    m_work.notify_one();
+}
+
+void GamePool::waitIdle()
+{
+    unique_lock<mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_live == 0; });
+}
+
+void GamePool::taskFinished()
+{
+    lock_guard<mutex> lock(m_mutex);
+    if (--m_live == 0)
+        m_idle.notify_all();
+}
+
+void GamePool::workerLoop()
+{
+    for (;;)
+    {
+        coroutine_handle<> h;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_work.wait(lock, [this]() { return m_stopping  ||  !m_queue.empty(); });
+            if (m_queue.empty())
+                return;
+            h = m_queue.front();
+            m_queue.pop_front();
+        }
+        h.resume();
+    }
+}
+
+//*********************************************************************
+//  AsyncPlayer
+//*********************************************************************
+
+Task<vector<Point>> AsyncPlayer::recommendAttacks(int k)
+{
+    vector<Point> shots;
+    for (int n = 0; n < k; n++)
+        shots.push_back(co_await recommendAttack());
+    co_return shots;
+}
+
+//*********************************************************************
+//  SyncPlayerAdapter
+//*********************************************************************
+
+SyncPlayerAdapter::SyncPlayerAdapter(Player* p)
+ : AsyncPlayer(p->name()), m_player(p)
+{}
+
+Task<bool> SyncPlayerAdapter::placeShips(Board& b)
+{
+    co_return m_player->placeShips(b);
+}
+
+Task<Point> SyncPlayerAdapter::recommendAttack()
+{
+    co_return m_player->recommendAttack();
+}
+
+Task<vector<Point>> SyncPlayerAdapter::recommendAttacks(int k)
+{
+    co_return m_player->recommendAttacks(k);
+}
+
+void SyncPlayerAdapter::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                           bool shipDestroyed, int shipId)
+{
+    m_player->recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+}
+
+void SyncPlayerAdapter::recordAttackByOpponent(Point p)
+{
+    m_player->recordAttackByOpponent(p);
+}
+
+void SyncPlayerAdapter::setOpponentView(const ShotView* view)
+{
+    m_player->setOpponentView(view);
+}
+
+//*********************************************************************
+//  RemotePlayer
+//*********************************************************************
+
+RemotePlayer::RemotePlayer(string nm, GamePool& pool, Player* placer)
+ : AsyncPlayer(move(nm)), m_pool(pool), m_placer(placer),
+   m_lastValid(false), m_lastHit(false)
+{}
+
+Task<bool> RemotePlayer::placeShips(Board& b)
+{
+    co_return m_placer->placeShips(b);
+}
+
+Task<Point> RemotePlayer::recommendAttack()
+{
+    co_return co_await AttackAwaiter{this};
+}
+
+void RemotePlayer::recordAttackResult(Point /* p */, bool validShot, bool shotHit,
+                                      bool /* shipDestroyed */, int /* shipId */)
+{
+    m_lastValid = validShot;
+    m_lastHit = shotHit;
+}
+
+void RemotePlayer::recordAttackByOpponent(Point /* p */)
+{}
+
+void RemotePlayer::supplyAttack(Point p)
+{
+    coroutine_handle<> resume;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_supplied = p;
+        resume = exchange(m_waiting, {});
+    }
+    if (resume)
+        m_pool.post(resume);
+}
+
+bool RemotePlayer::waitingForAttack() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return static_cast<bool>(m_waiting);
+}
+
+bool RemotePlayer::AttackAwaiter::await_ready()
+{
+    lock_guard<mutex> lock(player->m_mutex);
+    return player->m_supplied.has_value();
+}
+
+  // The shot may have been supplied after await_ready looked; in that case
+  // carry on without suspending.
+bool RemotePlayer::AttackAwaiter::await_suspend(coroutine_handle<> h)
+{
+    lock_guard<mutex> lock(player->m_mutex);
+    if (player->m_supplied.has_value())
+        return false;
+    player->m_waiting = h;
+    return true;
+}
+
+Point RemotePlayer::AttackAwaiter::await_resume()
+{
+    lock_guard<mutex> lock(player->m_mutex);
+    Point p = *player->m_supplied;
+    player->m_supplied.reset();
+    return p;
+}
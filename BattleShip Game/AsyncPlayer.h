@@ -0,0 +1,255 @@
+#ifndef ASYNCPLAYER_INCLUDED
+#define ASYNCPLAYER_INCLUDED
+
+#include "globals.h"
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class Board;
+class Player;
+struct ShotView;
+
+//*********************************************************************
+//  Task
+//*********************************************************************
+
+  // A lazily started coroutine producing a T.  Awaiting a Task starts it;
+  // when it finishes, the awaiting coroutine resumes on the same thread.
+template <typename T>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase
+{
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+};
+
+}  // namespace detail
+
+template <typename T>
+class Task
+{
+  public:
+    struct promise_type : detail::TaskPromiseBase
+    {
+        std::optional<T> value;
+        Task get_return_object() { return Task(handle::from_promise(*this)); }
+        void return_value(T v) { value.emplace(std::move(v)); }
+    };
+    using handle = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept : m_h(std::exchange(other.m_h, {})) {}
+    ~Task() { if (m_h) m_h.destroy(); }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+    {
+        m_h.promise().continuation = awaiter;
+        return m_h;
+    }
+    T await_resume() { return std::move(*m_h.promise().value); }
+
+  private:
+    explicit Task(handle h) : m_h(h) {}
+    handle m_h;
+};
+
+template <>
+class Task<void>
+{
+  public:
+    struct promise_type : detail::TaskPromiseBase
+    {
+        Task get_return_object() { return Task(handle::from_promise(*this)); }
+        void return_void() {}
+    };
+    using handle = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept : m_h(std::exchange(other.m_h, {})) {}
+    ~Task() { if (m_h) m_h.destroy(); }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+    {
+        m_h.promise().continuation = awaiter;
+        return m_h;
+    }
+    void await_resume() {}
+
+  private:
+    explicit Task(handle h) : m_h(h) {}
+    handle m_h;
+};
+
+//*********************************************************************
+//  GamePool
+//*********************************************************************
+
+  // A small pool of threads that runs suspended games.  Games only occupy
+  // a thread while they have work to do; a game waiting for a move is just
+  // a parked coroutine frame.
+class GamePool
+{
+  public:
+    GamePool(int nThreads = 0);     // 0 means one per hardware thread
+    ~GamePool();
+
+      // Start t on the pool; the pool owns it until it finishes
+    void spawn(Task<void> t);
+
+      // Queue a suspended coroutine to be resumed on a pool thread
+    void post(std::coroutine_handle<> h);
+
+      // Block until every spawned task has finished
+    void waitIdle();
+
+      // co_await pool.schedule() moves the awaiting coroutine onto the pool
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            GamePool* pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { pool->post(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+    GamePool(const GamePool&) = delete;
+    GamePool& operator=(const GamePool&) = delete;
+
+  private:
+    void workerLoop();
+    void taskFinished();
+
+    std::mutex m_mutex;
+    std::condition_variable m_work;
+    std::condition_variable m_idle;
+    std::deque<std::coroutine_handle<>> m_queue;
+    std::vector<std::thread> m_threads;
+    long long m_live;
+    bool m_stopping;
+
+    friend struct Detached;
+};
+
+//*********************************************************************
+//  AsyncPlayer
+//*********************************************************************
+
+  // The awaitable counterpart of Player: a game awaiting placeShips or
+  // recommendAttack suspends, rather than blocking its thread, until the
+  // player has an answer.
+class AsyncPlayer
+{
+  public:
+    AsyncPlayer(std::string nm) : m_name(std::move(nm)) {}
+    virtual ~AsyncPlayer() {}
+
+    const std::string& name() const { return m_name; }
+
+    virtual Task<bool> placeShips(Board& b) = 0;
+    virtual Task<Point> recommendAttack() = 0;
+      // The k shots of a salvo (see Player::recommendAttacks); by default,
+      // k awaited calls of recommendAttack
+    virtual Task<std::vector<Point>> recommendAttacks(int k);
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                        bool shipDestroyed, int shipId) = 0;
+    virtual void recordAttackByOpponent(Point p) = 0;
+      // See Player::setOpponentView; by default the view is not needed
+    virtual void setOpponentView(const ShotView* /* view */) {}
+
+    AsyncPlayer(const AsyncPlayer&) = delete;
+    AsyncPlayer& operator=(const AsyncPlayer&) = delete;
+
+  private:
+    std::string m_name;
+};
+
+  // Wraps a synchronous Player; its tasks complete without suspending.
+  // The adapter does not own the Player.
+class SyncPlayerAdapter : public AsyncPlayer
+{
+  public:
+    SyncPlayerAdapter(Player* p);
+    virtual Task<bool> placeShips(Board& b);
+    virtual Task<Point> recommendAttack();
+    virtual Task<std::vector<Point>> recommendAttacks(int k);
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                        bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+    virtual void setOpponentView(const ShotView* view);
+  private:
+    Player* m_player;
+};
+
+  // A player whose shots come from outside the game, such as a human at a
+  // console or a network peer.  recommendAttack suspends the game until
+  // another thread calls supplyAttack, which resumes it on the pool.
+  // Fleet placement is delegated to placer, which the player does not own.
+class RemotePlayer : public AsyncPlayer
+{
+  public:
+    RemotePlayer(std::string nm, GamePool& pool, Player* placer);
+    virtual Task<bool> placeShips(Board& b);
+    virtual Task<Point> recommendAttack();
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                        bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+
+    void supplyAttack(Point p);
+    bool waitingForAttack() const;
+
+      // The result of this player's most recent shot
+    bool lastShotValid() const { return m_lastValid; }
+    bool lastShotHit() const { return m_lastHit; }
+
+  private:
+    struct AttackAwaiter
+    {
+        RemotePlayer* player;
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> h);
+        Point await_resume();
+    };
+
+    GamePool& m_pool;
+    Player* m_placer;
+    mutable std::mutex m_mutex;
+    std::coroutine_handle<> m_waiting;
+    std::optional<Point> m_supplied;
+    bool m_lastValid;
+    bool m_lastHit;
+};
+
+#endif // ASYNCPLAYER_INCLUDED
@@ -1,7 +1,14 @@
 #include "Board.h"
 #include "Game.h"
 #include "globals.h"
+#include "Stats.h"
+#include "Renderer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <span>
+#include <vector>
 
 using namespace std;
 
@@ -10,52 +17,175 @@ class BoardImpl
   public:
     BoardImpl(const Game& g);
     void clear();
-    void block();
+    void block(double fraction);
     void unblock();
     bool placeShip(Point topOrLeft, int shipId, Direction dir);
     bool unplaceShip(Point topOrLeft, int shipId, Direction dir);
     void display(bool shotsOnly) const;
     bool attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+    int attackBatch(span<const Point> shots, span<ShotResult> results);
     bool allShipsDestroyed() const;
+    int shipsRemaining() const;
+    bool shipPosition(int shipId, Point& topOrLeft, Direction& dir) const;
+    CellSet legalAnchors(int length, Direction dir) const;
+    const ShotView& shotView() const { return m_view; }
+    size_t mark();
+    void rollback(size_t m);
+    void commit(size_t m);
 
   private:
-    const Game& m_game;
+    struct Placement
+    {
+        bool placed;
+        Point topOrLeft;
+        Direction dir;
+    };
+    //one journal entry: a cell's old symbol, or (shipId >= 0) a ship's old placement
+    struct Undo
+    {
+        int shipId;
+        int r, c;
+        char was;
+        Placement placement;
+    };
+    void setCell(int r, int c, char ch);
+    void writeCell(int r, int c, char ch);
+    void markSunk(int shipId, bool sunk);
+    void setPlacement(int shipId, const Placement& pl);
+    int shipIdAt(char ch) const { return m_shipIds[static_cast<unsigned char>(ch)]; }
+    //the Game's fleet table, copied so the hot paths need no calls into Game
+    vector<int> m_lengths;              //indexed by ship id
+    vector<char> m_symbols;
+    signed char m_shipIds[256];         //ship id for each symbol, -1 if none
     char m_board[10][10];
+    uint64_t m_free[MAXROWS];           //bit c of row r set while m_board[r][c] is '.'
+    vector<int> m_unhit;                //cells of each ship not yet hit, indexed by ship id
+    int m_unhitTotal;
+    ShotView m_view;                    //kept in step with m_board by writeCell
     int m_nRows, m_nCols;
+    vector<Placement> m_placements;     //indexed by ship id
+    vector<Undo> m_journal;             //changes since the oldest open mark
+    int m_openMarks;
 };
 
 BoardImpl::BoardImpl(const Game& g)
- : m_game(g)
+ : m_lengths(g.nShips()), m_symbols(g.nShips()), m_unhit(g.nShips(), 0), m_unhitTotal(0), m_view{},
+   m_placements(g.nShips(), Placement{ false, Point(), HORIZONTAL }), m_openMarks(0)
 {
     m_nCols = g.cols();
     m_nRows = g.rows();
+    fill(begin(m_shipIds), end(m_shipIds), -1);
+    for (int k = 0; k < g.nShips(); k++){
+        m_lengths[k] = g.shipLength(k);
+        m_symbols[k] = g.shipSymbol(k);
+        m_shipIds[static_cast<unsigned char>(m_symbols[k])] = static_cast<signed char>(k);
+    }
     for (int i = 0; i < m_nRows; i++){
         for (int j = 0; j < m_nCols; j++){
             m_board[i][j]='.';
         }
+        m_free[i] = (uint64_t(1) << m_nCols) - 1;
     }
 }
 
+void BoardImpl::setCell(int r, int c, char ch)
+{
+    if (m_openMarks > 0){
+        m_journal.push_back(Undo{ -1, r, c, m_board[r][c], Placement() });
+    }
+    writeCell(r, c, ch);
+}
+
+//the one place a cell changes, keeping the free-cell masks, unhit counts and shot view in step with it
+void BoardImpl::writeCell(int r, int c, char ch)
+{
+    char old = m_board[r][c];
+    if (old == ch) return;
+    int was = shipIdAt(old);
+    int now = shipIdAt(ch);
+    if (was >= 0){
+        m_unhit[was]--;
+        m_unhitTotal--;
+    }
+    if (now >= 0){
+        //a sunk ship gets a cell back only when a rollback undoes the shot that sank it
+        if (m_unhit[now]++ == 0) markSunk(now, false);
+        m_unhitTotal++;
+    }
+    m_board[r][c] = ch;
+    Point p(r, c);
+    if (ch == '.') m_free[r] |= uint64_t(1) << c;
+    else m_free[r] &= ~(uint64_t(1) << c);
+    //only shots show in the view, so placing and removing ships never touches it
+    if (old == 'X'){
+        m_view.hits.erase(p);
+        m_view.sunk.erase(p);
+    }
+    else if (old == 'o') m_view.misses.erase(p);
+    if (ch == 'X'){
+        m_view.hits.insert(p);
+        if (was >= 0 && m_unhit[was] == 0) markSunk(was, true);
+    }
+    else if (ch == 'o') m_view.misses.insert(p);
+}
+
+void BoardImpl::markSunk(int shipId, bool sunk)
+{
+    const Placement& pl = m_placements[shipId];
+    if (!pl.placed) return;
+    for (int k = 0; k < m_lengths[shipId]; k++){
+        Point p = pl.dir == HORIZONTAL ? Point(pl.topOrLeft.r, pl.topOrLeft.c + k) : Point(pl.topOrLeft.r + k, pl.topOrLeft.c);
+        if (sunk) m_view.sunk.insert(p);
+        else m_view.sunk.erase(p);
+    }
+}
+
+void BoardImpl::setPlacement(int shipId, const Placement& pl)
+{
+    if (m_openMarks > 0){
+        m_journal.push_back(Undo{ shipId, 0, 0, 0, m_placements[shipId] });
+    }
+    m_placements[shipId] = pl;
+}
+
 void BoardImpl::clear()
 {
+    //with nothing to journal, reset everything wholesale instead of cell by cell
+    if (m_openMarks == 0){
+        for (int i = 0; i < m_nRows; i++){
+            fill(m_board[i], m_board[i] + m_nCols, '.');
+            m_free[i] = (uint64_t(1) << m_nCols) - 1;
+        }
+        fill(m_unhit.begin(), m_unhit.end(), 0);
+        m_unhitTotal = 0;
+        m_view = ShotView{};
+        fill(m_placements.begin(), m_placements.end(), Placement{ false, Point(), HORIZONTAL });
+        return;
+    }
     for (int i = 0; i < m_nRows; i++){
         for (int j = 0; j < m_nCols; j++){
-            m_board[i][j]='.';
+            if (m_board[i][j] != '.') setCell(i, j, '.');
         }
     }
+    for (int k = 0; k < static_cast<int>(m_placements.size()); k++){
+        if (m_placements[k].placed) setPlacement(k, Placement{ false, Point(), HORIZONTAL });
+    }
 }
 
-void BoardImpl::block()
+void BoardImpl::block(double fraction)
 {
-    int half = m_nCols * m_nRows / 2;
-    for (int i = 0; i < half; i++){
+    int nBlocked = static_cast<int>(m_nCols * m_nRows * clamp(fraction, 0.0, 1.0));
+    for (int i = 0; i < nBlocked; i++){
         int r = randInt(m_nRows);
         int c = randInt(m_nCols);
+        STAT_ADD(STAT_BLOCK_DRAWS, 1);
         while (m_board[r][c] == 'X'){
             r = randInt(m_nRows);
             c = randInt(m_nCols);
+            STAT_ADD(STAT_BLOCK_DRAWS, 1);
+            STAT_ADD(STAT_BLOCK_REJECTIONS, 1);
         }
-        m_board[r][c] = 'X';
+        setCell(r, c, 'X');
     }
     
 }
@@ -65,7 +195,7 @@ void BoardImpl::unblock()
     for (int i = 0; i < m_nRows; i++){
         for (int j = 0; j < m_nCols; j++){
             if (m_board[i][j]=='X'){
-                m_board[i][j]='.';
+                setCell(i, j, '.');
             }
         }
     }
@@ -73,99 +203,120 @@ void BoardImpl::unblock()
 
 bool BoardImpl::placeShip(Point topOrLeft, int shipId, Direction dir)
 {
-    if (shipId < 0 || shipId > m_game.nShips()) return false;
-    if (dir == HORIZONTAL && topOrLeft.c + m_game.shipLength(shipId) > m_game.cols()) return false;
-    else if (dir == VERTICAL && topOrLeft.r + m_game.shipLength(shipId) > m_game.rows()) return false;
-    for (int i = 0; i < m_game.shipLength(shipId); i++){
-        if (dir == HORIZONTAL){
-            
-            if (m_board[topOrLeft.r][topOrLeft.c+i] != '.') return false;
-        }
-        else{
-            
-            if (m_board[topOrLeft.r+i][topOrLeft.c] != '.') return false;
+    if (shipId < 0 || shipId >= static_cast<int>(m_lengths.size())) return false;
+    int len = m_lengths[shipId];
+    char sym = m_symbols[shipId];
+    int r = topOrLeft.r;
+    int c = topOrLeft.c;
+    if (r < 0 || c < 0) return false;
+    //check every cell at once against the free-cell masks
+    uint64_t bit = uint64_t(1) << c;
+    uint64_t need = ((uint64_t(1) << len) - 1) << c;
+    if (dir == HORIZONTAL){
+        if (c + len > m_nCols) return false;
+        if ((m_free[r] & need) != need) return false;
+    }
+    else{
+        if (r + len > m_nRows) return false;
+        for (int i = 0; i < len; i++){
+            if (!(m_free[r+i] & bit)) return false;
         }
     }
-    
-    for (int i = 0; i < m_game.shipLength(shipId); i++){
-        if (dir == HORIZONTAL){
-            m_board[topOrLeft.r][topOrLeft.c+i] = m_game.shipSymbol(shipId);
+    //every cell is '.', so none is in the shot view: rather than go through setCell, fill
+    //them and count them in one go
+    if (m_unhit[shipId] == 0 && m_placements[shipId].placed) markSunk(shipId, false);
+    if (m_openMarks > 0){
+        for (int i = 0; i < len; i++){
+            if (dir == HORIZONTAL) m_journal.push_back(Undo{ -1, r, c+i, '.', Placement() });
+            else m_journal.push_back(Undo{ -1, r+i, c, '.', Placement() });
         }
-        else{
-            m_board[topOrLeft.r+i][topOrLeft.c] = m_game.shipSymbol(shipId);
+    }
+    if (dir == HORIZONTAL){
+        fill(m_board[r] + c, m_board[r] + c + len, sym);
+        m_free[r] &= ~need;
+    }
+    else{
+        for (int i = 0; i < len; i++){
+            m_board[r+i][c] = sym;
+            m_free[r+i] &= ~bit;
         }
     }
+    m_unhit[shipId] += len;
+    m_unhitTotal += len;
+    setPlacement(shipId, Placement{ true, topOrLeft, dir });
     return true;
 }
 
 bool BoardImpl::unplaceShip(Point topOrLeft, int shipId, Direction dir)
 {
-    if (shipId < 0 || shipId >= m_game.nShips()) return false;
-    for (int i = 0; i < m_game.shipLength(shipId); i++){
-        if (dir == HORIZONTAL){
-            if (m_board[topOrLeft.r][topOrLeft.c+i] != '.') return false;
-        }
-        else{
-            if (m_board[topOrLeft.r+i][topOrLeft.c] != '.') return false;
-        }
+    if (shipId < 0 || shipId >= static_cast<int>(m_lengths.size())) return false;
+    int len = m_lengths[shipId];
+    char sym = m_symbols[shipId];
+    int r = topOrLeft.r;
+    int c = topOrLeft.c;
+    if (r < 0 || c < 0) return false;
+    if (dir == HORIZONTAL && c + len > m_nCols) return false;
+    else if (dir == VERTICAL && r + len > m_nRows) return false;
+    //the ship must have been placed just there; cells already shot keep their marks
+    const Placement& pl = m_placements[shipId];
+    if (!pl.placed || pl.topOrLeft.r != r || pl.topOrLeft.c != c || pl.dir != dir) return false;
+    for (int i = 0; i < len; i++){
+        int rr = dir == HORIZONTAL ? r : r+i;
+        int cc = dir == HORIZONTAL ? c+i : c;
+        if (m_board[rr][cc] == sym) setCell(rr, cc, '.');
     }
-    for (int i = 0; i < m_game.shipLength(shipId); i++){
-        if (dir == HORIZONTAL){
-            if (m_board[topOrLeft.r][topOrLeft.c+i] != m_game.shipSymbol(shipId)) return false;
-        }
-        else{
-            if (m_board[topOrLeft.r+i][topOrLeft.c] != m_game.shipSymbol(shipId)) return false;
-        }
-    }
-    for (int i = 0; i < m_game.shipLength(shipId); i++){
-        if (dir == HORIZONTAL){
-            m_board[topOrLeft.r][topOrLeft.c+i] = '.';
+    setPlacement(shipId, Placement{ false, Point(), HORIZONTAL });
+    return true;
+}
+
+size_t BoardImpl::mark()
+{
+    m_openMarks++;
+    return m_journal.size();
+}
+
+void BoardImpl::rollback(size_t m)
+{
+    //undo newest first, so each cell ends up with the value it had at the mark
+    while (m_journal.size() > m){
+        const Undo& u = m_journal.back();
+        if (u.shipId >= 0){
+            m_placements[u.shipId] = u.placement;
         }
         else{
-            m_board[topOrLeft.r+i][topOrLeft.c] = '.';
+            writeCell(u.r, u.c, u.was);
         }
+        m_journal.pop_back();
     }
-    return true;
+    commit(m);
+}
+
+void BoardImpl::commit(size_t m)
+{
+    (void)m;
+    if (m_openMarks > 0) m_openMarks--;
+    if (m_openMarks == 0) m_journal.clear();
 }
 
 void BoardImpl::display(bool shotsOnly) const
 {
-    cout << "  ";
-    for (int i = 0; i < m_nCols; i++){
-        cout << i;
-    }
-    cout << endl;
-    
-    if (shotsOnly)
-    {
-        for (int i = 0; i < m_nRows; i++)
-        {
-            cout << i << " ";
-            for (int j = 0; j < m_nCols; j++)
-            {
-                if (m_board[i][j] == 'o' || m_board[i][j] == 'X')
-                {
-                    cout << m_board[i][j] ;
-                }
-                else
-                {
-                    cout << '.' ;
-                }
-            }
-            cout << endl;
-        }
+    //compose the header row and one line per row into a frame, then emit it in one write
+    int width = m_nCols + 2;
+    Renderer& renderer = Renderer::console();
+    char* frame = renderer.beginFrame(width, m_nRows + 1);
+    for (int j = 0; j < m_nCols; j++){
+        frame[2 + j] = static_cast<char>('0' + j % 10);
     }
-    
-    else
-    {
-        for (int i = 0; i < m_nRows; i++){
-            cout << i << " ";
-            for (int j = 0; j < m_nCols; j++){
-                cout << m_board[i][j] ;
-            }
-            cout << endl;
+    for (int i = 0; i < m_nRows; i++){
+        char* line = frame + (i + 1) * width;
+        line[0] = static_cast<char>('0' + i % 10);
+        for (int j = 0; j < m_nCols; j++){
+            char cell = m_board[i][j];
+            if (shotsOnly && cell != 'o' && cell != 'X') cell = '.';
+            line[2 + j] = cell;
         }
     }
+    renderer.endFrame();
 }
 
 bool BoardImpl::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
@@ -177,48 +328,119 @@ bool BoardImpl::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
         return false;
     }
     if (m_board[p.r][p.c] == '.'){
-        m_board[p.r][p.c] = 'o';
+        setCell(p.r, p.c, 'o');
         shotHit = false;
     }
     else{
         shotHit = true;
-        bool isLast = true;
-        for (int i = 0; i<m_game.nShips();i++){
-            if (m_game.shipSymbol(i) == m_board[p.r][p.c]){
-                shipId = i;
-            }
-        }
-        //if the symbol at p is the last symbol, the ship is considered to be destroyed
-        for (int i = 0; i < m_nRows; i++){
-            for (int j = 0; j < m_nCols; j++){
-                //if the symbol at p is found anywhere else except for p, the segment is not the ship's last segment
-                if ((i!=p.r||j!=p.c) && (m_board[i][j] == m_board[p.r][p.c])) isLast = false;
-            }
-        }
-        
-        if (isLast){
-            shipDestroyed = true;
-        }
-        else{
-            shipDestroyed = false;
-        }
-        
-        m_board[p.r][p.c]='X';
+        shipId = shipIdAt(m_board[p.r][p.c]);
+        setCell(p.r, p.c, 'X');
+        //the ship is destroyed once none of its cells is left unhit
+        shipDestroyed = m_unhit[shipId] == 0;
     }
     return true;
 }
 
+int BoardImpl::attackBatch(span<const Point> shots, span<ShotResult> results)
+{
+    //shots are resolved in order, so a repeated point in the salvo finds the cell already shot
+    int nValid = 0;
+    for (size_t k = 0; k < shots.size(); k++){
+        bool shotHit, shipDestroyed;
+        int shipId;
+        bool valid = attack(shots[k], shotHit, shipDestroyed, shipId);
+        ShotResult& res = results[k];
+        res.flags = 0;
+        if (valid){
+            res.flags |= ShotResult::VALID;
+            nValid++;
+        }
+        if (shotHit) res.flags |= ShotResult::HIT;
+        if (shipDestroyed) res.flags |= ShotResult::SUNK;
+        res.shipId = static_cast<int8_t>(shipId);
+    }
+    return nValid;
+}
+
 bool BoardImpl::allShipsDestroyed() const
 {
+    return m_unhitTotal == 0;
+}
+
+int BoardImpl::shipsRemaining() const
+{
+    int n = 0;
+    for (int left : m_unhit){
+        if (left > 0) n++;
+    }
+    return n;
+}
+
+bool BoardImpl::shipPosition(int shipId, Point& topOrLeft, Direction& dir) const
+{
+    if (shipId < 0 || shipId >= static_cast<int>(m_placements.size())) return false;
+    const Placement& pl = m_placements[shipId];
+    if (!pl.placed) return false;
+    topOrLeft = pl.topOrLeft;
+    dir = pl.dir;
+    return true;
+}
+
+CellSet BoardImpl::legalAnchors(int length, Direction dir) const
+{
+    //a horizontal anchor needs length free cells from it rightward: AND the row with itself shifted;
+    //a vertical anchor needs the same column free in length consecutive rows
+    CellSet anchors;
+    for (int i = 0; i < MAXROWS; i++){
+        anchors.rows[i] = 0;
+    }
+    if (length < 1) return anchors;
     for (int i = 0; i < m_nRows; i++){
-        for (int j = 0; j < m_nCols; j++){
-            //if any symbol other than these detected, assume not all ships destroyed
-            if (m_board[i][j] != 'X' && m_board[i][j] != 'o' && m_board[i][j] != '.'){
-                return false;
+        uint64_t a = m_free[i];
+        if (dir == HORIZONTAL){
+            for (int k = 1; k < length && a != 0; k++){
+                a &= m_free[i] >> k;
             }
         }
+        else{
+            if (i + length > m_nRows) break;
+            for (int k = 1; k < length && a != 0; k++){
+                a &= m_free[i+k];
+            }
+        }
+        anchors.rows[i] = a;
+    }
+    return anchors;
+}
+
+//******************** ShotView functions *****************************
+
+//take length unsunk hits in line with p, preferring the axis whose run of them is exactly
+//that long, and within the run the end p is at; the rest belong to ships still afloat
+void ShotView::inferSunk(Point p, int length)
+{
+    auto open = [this](int r, int c) {
+        return r >= 0 && r < MAXROWS && c >= 0 && c < MAXCOLS && hits.contains(Point(r, c)) && !sunk.contains(Point(r, c));
+    };
+    int lo[2] = { 0, 0 };
+    int hi[2] = { 0, 0 };
+    for (int axis = 0; axis < 2; axis++){
+        int dr = axis, dc = 1 - axis;
+        while (open(p.r + (lo[axis]-1)*dr, p.c + (lo[axis]-1)*dc)) lo[axis]--;
+        while (open(p.r + (hi[axis]+1)*dr, p.c + (hi[axis]+1)*dc)) hi[axis]++;
+    }
+    int run[2] = { hi[0] - lo[0] + 1, hi[1] - lo[1] + 1 };
+    int axis;
+    if (run[0] == length) axis = 0;
+    else if (run[1] == length) axis = 1;
+    else if (run[0] >= length) axis = 0;
+    else if (run[1] >= length) axis = 1;
+    else axis = run[0] >= run[1] ? 0 : 1;
+    int first = max(lo[axis], -(length - 1));
+    int last = min(hi[axis], first + length - 1);
+    for (int k = first; k <= last; k++){
+        sunk.insert(Point(p.r + k*axis, p.c + k*(1 - axis)));
     }
-    return true;
 }
 
 //******************** Board functions ********************************
@@ -241,9 +463,9 @@ void Board::clear()
     m_impl->clear();
 }
 
-void Board::block()
+void Board::block(double fraction)
 {
-    return m_impl->block();
+    return m_impl->block(fraction);
 }
 
 void Board::unblock()
@@ -271,7 +493,48 @@ bool Board::attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId)
     return m_impl->attack(p, shotHit, shipDestroyed, shipId);
 }
 
+int Board::attackBatch(span<const Point> shots, span<ShotResult> results)
+{
+    assert(results.size() >= shots.size());
+    return m_impl->attackBatch(shots, results);
+}
+
 bool Board::allShipsDestroyed() const
 {
     return m_impl->allShipsDestroyed();
 }
+
+int Board::shipsRemaining() const
+{
+    return m_impl->shipsRemaining();
+}
+
+bool Board::shipPosition(int shipId, Point& topOrLeft, Direction& dir) const
+{
+    return m_impl->shipPosition(shipId, topOrLeft, dir);
+}
+
+CellSet Board::legalAnchors(int length, Direction dir) const
+{
+    return m_impl->legalAnchors(length, dir);
+}
+
+const ShotView& Board::shotView() const
+{
+    return m_impl->shotView();
+}
+
+Board::Mark Board::mark()
+{
+    return m_impl->mark();
+}
+
+void Board::rollback(Mark m)
+{
+    m_impl->rollback(m);
+}
+
+void Board::commit(Mark m)
+{
+    m_impl->commit(m);
+}
@@ -2,23 +2,97 @@
 #define BOARD_INCLUDED
 
 #include "globals.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 
 class Game;
 class BoardImpl;
 
+  // A set of cells held as one bitmask per row: bit c of rows[r] is (r, c)
+struct CellSet
+{
+    std::uint64_t rows[MAXROWS];
+    bool contains(Point p) const { return (rows[p.r] >> p.c) & 1; }
+    void insert(Point p) { rows[p.r] |= std::uint64_t(1) << p.c; }
+    void erase(Point p) { rows[p.r] &= ~(std::uint64_t(1) << p.c); }
+    int size() const
+    {
+        int n = 0;
+        for (std::uint64_t row : rows)
+            n += std::popcount(row);
+        return n;
+    }
+};
+
+  // What an opponent may know of a board: the cells shot at, split into
+  // hits and misses, and which hits are on ships since sunk -- but not
+  // which ship any hit belongs to.  Board keeps one up to date as shots
+  // land, so a player can be handed a reference to it instead of keeping
+  // its own record.  While a board is blocked, its blocked cells read as
+  // hits.
+struct ShotView
+{
+    CellSet hits;
+    CellSet misses;
+    CellSet sunk;       // a subset of hits
+    bool shot(Point p) const { return hits.contains(p) || misses.contains(p); }
+      // For a view rebuilt from shot results rather than kept by a Board:
+      // mark as sunk the length hits most likely to be the ship that the
+      // shot at p, already in hits, sank
+    void inferSunk(Point p, int length);
+};
+
+  // The outcome of one shot of a salvo, packed into two bytes
+struct ShotResult
+{
+    enum : std::uint8_t { VALID = 1, HIT = 2, SUNK = 4 };
+    std::uint8_t flags;
+    std::int8_t shipId;     // the ship hit, or -1
+    bool valid() const { return flags & VALID; }
+    bool hit() const { return flags & HIT; }
+    bool sunk() const { return flags & SUNK; }
+};
+
 class Board
 {
   public:
     Board(const Game& g);
     ~Board();
     void clear();
-    void block();
+      // Block this share of the board's cells, chosen at random
+    void block(double fraction = 0.5);
     void unblock();
     bool placeShip(Point topOrLeft, int shipId, Direction dir);
     bool unplaceShip(Point topOrLeft, int shipId, Direction dir);
     void display(bool shotsOnly) const;
     bool attack(Point p, bool& shotHit, bool& shipDestroyed, int& shipId);
+      // Fire every shot in shots, in order, storing the outcome of shots[k]
+      // in results[k]; results must be at least as long as shots.  Returns
+      // the number of valid shots.
+    int attackBatch(std::span<const Point> shots, std::span<ShotResult> results);
     bool allShipsDestroyed() const;
+      // Ships with at least one cell not yet hit
+    int shipsRemaining() const;
+      // Where ship shipId was last placed; false if it is not on the board
+    bool shipPosition(int shipId, Point& topOrLeft, Direction& dir) const;
+      // Every top-left cell at which a ship of this length would fit in
+      // direction dir without leaving the board or touching a cell that is
+      // occupied, blocked or already shot at
+    CellSet legalAnchors(int length, Direction dir) const;
+      // The live view of this board's shots; it stays valid, and current,
+      // for the life of the board
+    const ShotView& shotView() const;
+
+      // Undo journal for search.  mark() starts recording every change to
+      // the board; rollback(m) undoes the changes made since m, and
+      // commit(m) keeps them.  Marks nest and are closed newest first.
+      // Nothing is recorded while no mark is open.
+    typedef std::size_t Mark;
+    Mark mark();
+    void rollback(Mark m);
+    void commit(Mark m);
       // We prevent a Board object from being copied or assigned
     Board(const Board&) = delete;
     Board& operator=(const Board&) = delete;
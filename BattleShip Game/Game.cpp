@@ -2,41 +2,25 @@
 #include "Board.h"
 #include "Player.h"
 #include "globals.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "AsyncPlayer.h"
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <cstdint>
 #include <cstdlib>
 #include <cctype>
+#include <map>
+#include <mutex>
+#include <unordered_set>
 
 using namespace std;
 
-class Ship{
-public:
-    Ship(int length, char symbol, string name, int ID);
-    int getLen();
-    char getSym();
-    string getName();
-    
-private:
-    int m_length;
-    char m_symbol;
-    string m_name;
-    int m_ID;
-};
-
-Ship::Ship(int length, char symbol, string name, int ID) : m_length(length), m_symbol(symbol), m_name(name), m_ID(ID){}
-
-int Ship::getLen(){
-    return m_length;
-}
-
-char Ship::getSym(){
-    return m_symbol;
-}
-
-string Ship::getName(){
-    return m_name;
-}
-
 class GameImpl
 {
 public:
@@ -50,11 +34,23 @@ public:
     int nShips() const;
     int shipLength(int shipId) const;
     char shipSymbol(int shipId) const;
-    string shipName(int shipId) const;
-    Player* play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause);
+    string_view shipName(int shipId) const;
+    int shipIdForSymbol(char symbol) const;
+    void setShotsPerTurn(int n);
+    int shotsPerTurn() const;
+    Player* play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause, bool showOutput);
+    Task<AsyncPlayer*> playAsync(const Game& g, AsyncPlayer* p1, AsyncPlayer* p2);
 private:
-    int m_nRows, m_nCols, m_nShips;
-    Ship* m_ships[100];         //nShips() will always be less than 100
+    bool takeTurn(Player* attacker, Player* defender, Board& attBoard, Board& defBoard, bool shouldPause, bool showOutput);
+    void takeSalvo(Player* attacker, Player* defender, Board& defBoard, int k, bool showOutput);
+    int salvoSize(const Board& attBoard) const;
+    int m_nRows, m_nCols;
+    int m_shotsPerTurn;
+    //fleet table: entry i of each array describes ship i
+    vector<int> m_lengths;
+    vector<char> m_symbols;
+    deque<string> m_names;      //a deque, so shipName's views survive addShip
+    int m_symbolToId[128];      //ship id for each ASCII symbol, -1 if unused
 };
 
 
@@ -65,14 +61,14 @@ void waitForEnter()
     cin.ignore(10000, '\n');
 }
 
-GameImpl::GameImpl(int nRows, int nCols) : m_nRows(nRows), m_nCols(nCols), m_nShips(0){}
-
-GameImpl::~GameImpl(){
-    for (int i = 0; i < m_nShips; i++){
-        delete m_ships[i];
+GameImpl::GameImpl(int nRows, int nCols) : m_nRows(nRows), m_nCols(nCols), m_shotsPerTurn(1){
+    for (int i = 0; i < 128; i++){
+        m_symbolToId[i] = -1;
     }
 }
 
+GameImpl::~GameImpl(){}
+
 int GameImpl::rows() const
 {
     return m_nRows;
@@ -95,126 +91,236 @@ Point GameImpl::randomPoint() const
 
 bool GameImpl::addShip(int length, char symbol, string name)
 {
-    m_ships[m_nShips] = new Ship(length, symbol, name, m_nShips);
-    m_nShips++;
+    m_symbolToId[static_cast<unsigned char>(symbol)] = nShips();
+    m_lengths.push_back(length);
+    m_symbols.push_back(symbol);
+    m_names.push_back(name);
     return true;
 }
 
 int GameImpl::nShips() const
 {
-    return m_nShips;
+    return static_cast<int>(m_lengths.size());
 }
 
 int GameImpl::shipLength(int shipId) const
 {
-    return m_ships[shipId] -> getLen();
+    return m_lengths[shipId];
 }
 
 char GameImpl::shipSymbol(int shipId) const
 {
-    return m_ships[shipId] -> getSym();
+    return m_symbols[shipId];
+}
+
+string_view GameImpl::shipName(int shipId) const
+{
+    return m_names[shipId];
+}
+
+int GameImpl::shipIdForSymbol(char symbol) const
+{
+    unsigned char u = static_cast<unsigned char>(symbol);
+    return u < 128 ? m_symbolToId[u] : -1;
+}
+
+void GameImpl::setShotsPerTurn(int n)
+{
+    m_shotsPerTurn = n;
 }
 
-string GameImpl::shipName(int shipId) const
+int GameImpl::shotsPerTurn() const
 {
-    return m_ships[shipId] -> getName();
+    return m_shotsPerTurn;
 }
 
-Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause)  
+//the number of shots the owner of attBoard fires this turn
+int GameImpl::salvoSize(const Board& attBoard) const
 {
+    if (m_shotsPerTurn == SHOTS_PER_SHIP) return attBoard.shipsRemaining();
+    return m_shotsPerTurn;
+}
+
+Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool shouldPause, bool showOutput)
+{
+    STAT_ADD(STAT_GAMES, 1);
+    STAT_TIME(STAT_GAME_NS);
     bool p1Placed = false;
     bool p2Placed = false;
     
-    for(int i =  0; i<50; i++){
-        if (p1 -> placeShips(b1)) {
-            p1Placed = true;
-            break;
+    {
+        STAT_TIME(STAT_PLACEMENT_NS);
+        for(int i =  0; i<50; i++){
+            STAT_ADD(STAT_PLACE_ATTEMPTS, 1);
+            TraceSpan span("placeShips", p1->name());
+            if (p1 -> placeShips(b1)) {
+                p1Placed = true;
+                break;
+            }
+            STAT_ADD(STAT_PLACE_FAILURES, 1);
         }
-    }
-    
-    for (int i =  0; i<50; i++){
-        if (p2 -> placeShips(b2)) {
-            p2Placed=true;
-            break;
+        
+        for (int i =  0; i<50; i++){
+            STAT_ADD(STAT_PLACE_ATTEMPTS, 1);
+            TraceSpan span("placeShips", p2->name());
+            if (p2 -> placeShips(b2)) {
+                p2Placed=true;
+                break;
+            }
+            STAT_ADD(STAT_PLACE_FAILURES, 1);
         }
     }
     
     if  (p1Placed==false || p2Placed == false) return nullptr;
+    p1->setOpponentView(&b2.shotView());
+    p2->setOpponentView(&b1.shotView());
     
     while (true){
-        bool isHit = false;
-        bool isDes = false;
-        int hitID;
-        cout << p1->name()<<"'s turn. Board for "<<p2->name()<<endl;
-        b2.display(p1 -> isHuman());        
-        Point rec = p1->recommendAttack();
-        if (b2.attack(rec, isHit, isDes, hitID)){p1->recordAttackResult(rec, true, isHit, isDes, hitID);}      
-        else {
-            cout << p1->name()<<" wasted a shot at ("<<rec.r<<','<<rec.c<<")."<<endl;
-            p1->recordAttackResult(rec, false, false, false, -1);
+        if (takeTurn(p1, p2, b1, b2, shouldPause, showOutput)) return p1;
+        if (takeTurn(p2, p1, b2, b1, shouldPause, showOutput)) return p2;
+    }
+    
+    return nullptr;
+}
+
+//same rules as play(), headless, but every player call may suspend the game
+Task<AsyncPlayer*> GameImpl::playAsync(const Game& g, AsyncPlayer* p1, AsyncPlayer* p2)
+{
+    STAT_ADD(STAT_GAMES, 1);
+    Board b1(g);
+    Board b2(g);
+    AsyncPlayer* players[2] = { p1, p2 };
+    Board* boards[2] = { &b1, &b2 };
+    for (int k = 0; k < 2; k++){
+        bool placed = false;
+        for (int i = 0; i < 50 && !placed; i++){
+            STAT_ADD(STAT_PLACE_ATTEMPTS, 1);
+            placed = co_await players[k]->placeShips(*boards[k]);
+            if (!placed) STAT_ADD(STAT_PLACE_FAILURES, 1);
         }
-        if (isHit || isDes){
-            cout << p1->name() << " attacked (" << rec.r << "," << rec.c <<") and hit something, resulting in: " << endl;
-            b2.display(p1->isHuman());
-            if(shouldPause){
-                waitForEnter();
+        if (!placed) co_return nullptr;
+    }
+    p1->setOpponentView(&b2.shotView());
+    p2->setOpponentView(&b1.shotView());
+    
+    for (int turn = 0; ; turn = 1 - turn){
+        AsyncPlayer* attacker = players[turn];
+        AsyncPlayer* defender = players[1 - turn];
+        Board& defBoard = *boards[1 - turn];
+        int k = salvoSize(*boards[turn]);
+        if (k != 1){
+            vector<Point> shots = co_await attacker->recommendAttacks(k);
+            vector<ShotResult> results(shots.size());
+            STAT_ADD(STAT_SHOTS, shots.size());
+            int nValid = defBoard.attackBatch(shots, results);
+            STAT_ADD(STAT_WASTED_SHOTS, shots.size() - nValid);
+            for (size_t i = 0; i < shots.size(); i++){
+                const ShotResult& res = results[i];
+                attacker->recordAttackResult(shots[i], res.valid(), res.hit(), res.sunk(), res.shipId);
+                defender->recordAttackByOpponent(shots[i]);
             }
+            if (defBoard.allShipsDestroyed()) co_return attacker;
+            continue;
         }
-        else{
-            cout<<p1->name() << " attacked (" << rec.r << "," << rec.c <<") and missed, resulting in: " << endl;
-            b2.display(p1->isHuman());
-            if(shouldPause){
-                waitForEnter();
-            }
+        Point rec = co_await attacker->recommendAttack();
+        bool isHit, isDes;
+        int hitID;
+        STAT_ADD(STAT_SHOTS, 1);
+        bool valid = defBoard.attack(rec, isHit, isDes, hitID);
+        if (!valid) STAT_ADD(STAT_WASTED_SHOTS, 1);
+        attacker->recordAttackResult(rec, valid, isHit, isDes, hitID);
+        defender->recordAttackByOpponent(rec);
+        if (defBoard.allShipsDestroyed()) co_return attacker;
+    }
+}
+
+//attacker fires a salvo of k shots at defBoard, resolved together after all k are chosen
+void GameImpl::takeSalvo(Player* attacker, Player* defender, Board& defBoard, int k, bool showOutput)
+{
+    vector<Point> shots;
+    {
+        TraceSpan span("recommendAttacks", attacker->name());
+        shots = attacker->recommendAttacks(k);
+    }
+    vector<ShotResult> results(shots.size());
+    STAT_ADD(STAT_SHOTS, shots.size());
+    int nValid = defBoard.attackBatch(shots, results);
+    STAT_ADD(STAT_WASTED_SHOTS, shots.size() - nValid);
+    {
+        TraceSpan span("recordAttackResult", attacker->name());
+        for (size_t i = 0; i < shots.size(); i++){
+            const ShotResult& res = results[i];
+            attacker->recordAttackResult(shots[i], res.valid(), res.hit(), res.sunk(), res.shipId);
         }
-        if (b2.allShipsDestroyed()){
-            cout << p1->name() << " wins!"<<endl;
-            if (p2->isHuman()){
-                cout << "Here is " << p1->name() << "'s board: " << endl;
-                b1.display(false);
-            }
-            return p1;
+    }
+    for (const Point& p : shots){
+        defender->recordAttackByOpponent(p);
+    }
+    if (showOutput){
+        for (size_t i = 0; i < shots.size(); i++){
+            cout << attacker->name() << " attacked (" << shots[i].r << "," << shots[i].c << ") and ";
+            if (!results[i].valid()) cout << "wasted the shot." << endl;
+            else if (results[i].hit()) cout << "hit something." << endl;
+            else cout << "missed." << endl;
         }
-        
-        isHit = false; isDes = false; hitID = -1;
-        
-        cout << p2->name()<<"'s turn. Board for "<<p1->name()<<endl;
-
-        b1.display(p2->isHuman());
-        rec = p2->recommendAttack();
-        if(b1.attack(rec, isHit, isDes, hitID)){p2->recordAttackResult(rec, true, isHit, isDes, hitID);}
-        else{
-            cout << p2->name()<<" wasted a shot at ("<<rec.r<<','<<rec.c<<")."<<endl;
-            p2->recordAttackResult(rec, false, false, false, -1);
+        cout << "resulting in: " << endl;
+    }
+}
+
+//attacker takes one turn at defBoard; returns true if it sank the defender's last ship
+bool GameImpl::takeTurn(Player* attacker, Player* defender, Board& attBoard, Board& defBoard, bool shouldPause, bool showOutput)
+{
+    if (showOutput){
+        cout << attacker->name()<<"'s turn. Board for "<<defender->name()<<endl;
+        defBoard.display(attacker->isHuman());
+    }
+    int k = salvoSize(attBoard);
+    if (k != 1){
+        takeSalvo(attacker, defender, defBoard, k, showOutput);
+        if (showOutput) defBoard.display(attacker->isHuman());
+    }
+    else{
+        bool isHit = false;
+        bool isDes = false;
+        int hitID = -1;
+        Point rec;
+        {
+            TraceSpan span("recommendAttack", attacker->name());
+            rec = attacker->recommendAttack();
         }
-        
-        if (isHit || isDes){
-            cout << p2->name() << " attacked (" << rec.r << "," << rec.c <<") and hit something, resulting in: " << endl;
-            b1.display(p2 -> isHuman());
-            if(shouldPause){
-                waitForEnter();
-            }
+        STAT_ADD(STAT_SHOTS, 1);
+        bool valid = defBoard.attack(rec, isHit, isDes, hitID);
+        if (!valid){
+            STAT_ADD(STAT_WASTED_SHOTS, 1);
+            if (showOutput) cout << attacker->name()<<" wasted a shot at ("<<rec.r<<','<<rec.c<<")."<<endl;
         }
-        
-        else{
-            cout<<p2->name() << " attacked (" << rec.r << "," << rec.c <<") and missed, resulting in: " << endl;
-            b1.display(p2 -> isHuman());
-            if(shouldPause){
-                waitForEnter();
-            }
+        {
+            TraceSpan span("recordAttackResult", attacker->name());
+            attacker->recordAttackResult(rec, valid, isHit, isDes, hitID);
         }
-        
-        if (b1.allShipsDestroyed()){
-            cout << p2->name() << " wins!"<<endl;
-            if (p1 -> isHuman()){
-                cout << "Here is " << p2->name() << "'s board: " << endl;
-                b2.display(false);
+        defender->recordAttackByOpponent(rec);
+        if (showOutput){
+            if (isHit || isDes)
+                cout << attacker->name() << " attacked (" << rec.r << "," << rec.c <<") and hit something, resulting in: " << endl;
+            else
+                cout << attacker->name() << " attacked (" << rec.r << "," << rec.c <<") and missed, resulting in: " << endl;
+            defBoard.display(attacker->isHuman());
+        }
+    }
+    if (showOutput && shouldPause){
+        waitForEnter();
+    }
+    if (defBoard.allShipsDestroyed()){
+        if (showOutput){
+            cout << attacker->name() << " wins!"<<endl;
+            if (defender->isHuman()){
+                cout << "Here is " << attacker->name() << "'s board: " << endl;
+                attBoard.display(false);
             }
-            return p2;
         }
+        return true;
     }
-    
-    return nullptr;
+    return false;
 }
 
 
@@ -224,6 +330,150 @@ Player* GameImpl::play(Player* p1, Player* p2, Board& b1, Board& b2, bool should
 
 
 
+//*********************************************************************
+//  Fleet feasibility
+//*********************************************************************
+
+namespace {
+
+//cell (r, c) is bit r*cols + c
+struct Cells
+{
+    uint64_t w[2];
+    bool has(int bit) const { return (w[bit >> 6] >> (bit & 63)) & 1; }
+    void add(int bit) { w[bit >> 6] |= uint64_t(1) << (bit & 63); }
+    void remove(int bit) { w[bit >> 6] &= ~(uint64_t(1) << (bit & 63)); }
+};
+
+struct SearchState
+{
+    int pos;
+    Cells occupied;
+    uint64_t left;
+    bool operator==(const SearchState& o) const
+    {
+        return pos == o.pos && occupied.w[0] == o.occupied.w[0] && occupied.w[1] == o.occupied.w[1] && left == o.left;
+    }
+};
+
+struct SearchStateHash
+{
+    size_t operator()(const SearchState& s) const
+    {
+        uint64_t h = (s.occupied.w[0] * 0x9e3779b97f4a7c15ULL) ^ s.occupied.w[1] ^ (s.left * 0xbf58476d1ce4e5b9ULL) ^ uint64_t(s.pos);
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+//visits the cells in row-major order and decides for each free one whether a ship starts
+//there, across or down, or it stays empty.  Cells below and to the right that earlier ships
+//cover are carried in a bitboard, so a state is the position, that bitboard and the ships
+//still to place; every state that failed is remembered.  Ships of equal length are never
+//told apart, so no packing is searched twice under different ship orders.
+class PackingSearch
+{
+public:
+    PackingSearch(int rows, int cols, const vector<int>& lengths);
+    bool feasible();
+private:
+    bool place(int pos, Cells occupied, uint64_t left, int areaLeft);
+    int m_rows, m_cols;
+    vector<int> m_distinct;     //distinct lengths, longest first
+    vector<int> m_counts;       //ships of each distinct length
+    vector<uint64_t> m_radix;   //place value of each length's count in the ships left
+    unordered_set<SearchState, SearchStateHash> m_failed;
+};
+
+PackingSearch::PackingSearch(int rows, int cols, const vector<int>& lengths)
+ : m_rows(rows), m_cols(cols)
+{
+    vector<int> sorted(lengths);
+    sort(sorted.begin(), sorted.end(), greater<int>());
+    for (int len : sorted){
+        if (m_distinct.empty() || m_distinct.back() != len){
+            m_distinct.push_back(len);
+            m_counts.push_back(0);
+        }
+        m_counts.back()++;
+    }
+}
+
+bool PackingSearch::feasible()
+{
+    //the ships left are one mixed-radix number, digit k counting ships of m_distinct[k];
+    //once the area fits the board, the product of the radices is far below 2^64
+    uint64_t left = 0;
+    uint64_t radix = 1;
+    int area = 0;
+    for (size_t k = 0; k < m_distinct.size(); k++){
+        area += m_counts[k] * m_distinct[k];
+        if (area > m_rows * m_cols) return false;
+        m_radix.push_back(radix);
+        left += radix * m_counts[k];
+        radix *= m_counts[k] + 1;
+    }
+    return place(0, Cells{ { 0, 0 } }, left, area);
+}
+
+bool PackingSearch::place(int pos, Cells occupied, uint64_t left, int areaLeft)
+{
+    if (left == 0) return true;
+    int nCells = m_rows * m_cols;
+    if (pos == nCells) return false;
+    if (occupied.has(pos)){
+        occupied.remove(pos);
+        return place(pos + 1, occupied, left, areaLeft);
+    }
+    int freeCells = nCells - pos - (popcount(occupied.w[0]) + popcount(occupied.w[1]));
+    if (areaLeft > freeCells) return false;
+    SearchState state{ pos, occupied, left };
+    if (m_failed.count(state)) return false;
+    int r = pos / m_cols;
+    int c = pos % m_cols;
+    for (size_t k = 0; k < m_distinct.size(); k++){
+        if ((left / m_radix[k]) % (m_counts[k] + 1) == 0) continue;
+        int len = m_distinct[k];
+        uint64_t rest = left - m_radix[k];
+        for (int dir = 0; dir < (len == 1 ? 1 : 2); dir++){
+            //cell pos itself is free; the ship's other cells must be too
+            if ((dir == 0 && c + len > m_cols) || (dir == 1 && r + len > m_rows)) continue;
+            Cells next = occupied;
+            bool fits = true;
+            for (int i = 1; i < len && fits; i++){
+                int bit = dir == 0 ? pos + i : pos + i * m_cols;
+                if (next.has(bit)) fits = false;
+                else next.add(bit);
+            }
+            if (fits && place(pos + 1, next, rest, areaLeft - len)) return true;
+        }
+    }
+    if (place(pos + 1, occupied, left, areaLeft)) return true;
+    m_failed.insert(state);
+    return false;
+}
+
+//whether ships of these lengths can all be placed on a rows x cols board, remembered per
+//board size and fleet so a fleet is only ever searched once per process
+bool fleetFits(int rows, int cols, vector<int> lengths)
+{
+    static mutex cacheMutex;
+    static map<vector<int>, bool> cache;
+    sort(lengths.begin(), lengths.end());
+    vector<int> key = lengths;
+    key.insert(key.begin(), { rows, cols });
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) return it->second;
+    }
+    bool fits = PackingSearch(rows, cols, lengths).feasible();
+    lock_guard<mutex> lock(cacheMutex);
+    cache[key] = fits;
+    return fits;
+}
+
+}  // namespace
+
 Game::Game(int nRows, int nCols)
 {
     if (nRows < 1  ||  nRows > MAXROWS)
@@ -289,22 +539,29 @@ bool Game::addShip(int length, char symbol, string name)
              << endl;
         return false;
     }
+    if (shipIdForSymbol(symbol) != -1)
+    {
+        cout << "Ship symbol " << symbol
+             << " must not be used for more than one ship" << endl;
+        return false;
+    }
     int totalOfLengths = 0;
     for (int s = 0; s < nShips(); s++)
-    {
         totalOfLengths += shipLength(s);
-        if (shipSymbol(s) == symbol)
-        {
-            cout << "Ship symbol " << symbol
-                 << " must not be used for more than one ship" << endl;
-            return false;
-        }
-    }
     if (totalOfLengths + length > rows() * cols())
     {
         cout << "Board is too small to fit all ships" << endl;
         return false;
     }
+    vector<int> lengths;
+    for (int s = 0; s < nShips(); s++)
+        lengths.push_back(shipLength(s));
+    lengths.push_back(length);
+    if (!fleetFits(rows(), cols(), lengths))
+    {
+        cout << "Ships cannot all be placed on the board together" << endl;
+        return false;
+    }
     return m_impl->addShip(length, symbol, name);
 }
 
@@ -325,18 +582,48 @@ char Game::shipSymbol(int shipId) const
     return m_impl->shipSymbol(shipId);
 }
 
-string Game::shipName(int shipId) const
+string_view Game::shipName(int shipId) const
 {
     assert(shipId >= 0  &&  shipId < nShips());
     return m_impl->shipName(shipId);
 }
 
-Player* Game::play(Player* p1, Player* p2, bool shouldPause)
+int Game::shipIdForSymbol(char symbol) const
+{
+    return m_impl->shipIdForSymbol(symbol);
+}
+
+void Game::setShotsPerTurn(int n)
+{
+    assert(n >= 0);
+    m_impl->setShotsPerTurn(n);
+}
+
+int Game::shotsPerTurn() const
+{
+    return m_impl->shotsPerTurn();
+}
+
+Player* Game::play(Player* p1, Player* p2, bool shouldPause, bool showOutput)
 {
     if (p1 == nullptr  ||  p2 == nullptr  ||  nShips() == 0)
         return nullptr;
     Board b1(*this);
     Board b2(*this);
-    return m_impl->play(p1, p2, b1, b2, shouldPause);
+    Player* winner = m_impl->play(p1, p2, b1, b2, shouldPause, showOutput);
+      // The views die with the boards
+    p1->setOpponentView(nullptr);
+    p2->setOpponentView(nullptr);
+    return winner;
+}
+
+Task<AsyncPlayer*> Game::playAsync(AsyncPlayer* p1, AsyncPlayer* p2)
+{
+    if (p1 == nullptr  ||  p2 == nullptr  ||  nShips() == 0)
+        co_return nullptr;
+    AsyncPlayer* winner = co_await m_impl->playAsync(*this, p1, p2);
+    p1->setOpponentView(nullptr);
+    p2->setOpponentView(nullptr);
+    co_return winner;
 }
 
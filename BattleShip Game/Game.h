@@ -2,11 +2,18 @@
 #define GAME_INCLUDED
 
 #include <string>
+#include <string_view>
 #include <cassert>
 
 class Point;
 class Player;
+class AsyncPlayer;
 class GameImpl;
+template <typename T> class Task;
+
+  // For Game::setShotsPerTurn: each turn, fire one shot per ship of one's
+  // own fleet still afloat
+const int SHOTS_PER_SHIP = 0;
 
 class Game
 {
@@ -21,8 +28,19 @@ class Game
     int nShips() const;
     int shipLength(int shipId) const;
     char shipSymbol(int shipId) const;
-    std::string shipName(int shipId) const;
-    Player* play(Player* p1, Player* p2, bool shouldPause = true);
+      // The view stays valid for the life of the Game
+    std::string_view shipName(int shipId) const;
+    int shipIdForSymbol(char symbol) const;  // -1 if no ship uses symbol
+      // Shots a player fires each turn: 1 (the default) for the classic
+      // game, k > 1 for a salvo of k, or SHOTS_PER_SHIP.  All the shots of
+      // a salvo are chosen before any of them is resolved.
+    void setShotsPerTurn(int n);
+    int shotsPerTurn() const;
+    Player* play(Player* p1, Player* p2, bool shouldPause = true,
+                 bool showOutput = true);
+      // Headless play between asynchronous players (see AsyncPlayer.h).
+      // The Game must outlive the returned task.
+    Task<AsyncPlayer*> playAsync(AsyncPlayer* p1, AsyncPlayer* p2);
       // We prevent a Game object from being copied or assigned
     Game(const Game&) = delete;
     Game& operator=(const Game&) = delete;
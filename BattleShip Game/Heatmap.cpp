@@ -0,0 +1,109 @@
+#include "Heatmap.h"
+#include <algorithm>
+
+using namespace std;
+
+Heatmap::Heatmap(int rows, int cols, const vector<int>& lengths)
+ : m_rows(rows), m_cols(cols), m_blocked(size_t(rows) * cols, 0),
+   m_across(size_t(rows) * cols, 0), m_down(size_t(rows) * cols, 0)
+{
+    for (int len : lengths)
+    {
+        if (len < 1)
+            continue;
+        if (size_t(len) >= m_afloat.size())
+            m_afloat.resize(len + 1, 0);
+        m_afloat[len]++;
+    }
+    countAll();
+}
+
+int64_t Heatmap::coverings(int r1, int c1, int r2, int c2) const
+{
+    if (r1 != r2  &&  c1 != c2)
+        return 0;
+      // Work in offsets along the line: the span [u, v] must fit inside the
+      // run [a, b] of unblocked cells around it
+    bool across = (r1 == r2);
+    int u = across ? min(c1, c2) : min(r1, r2);
+    int v = across ? max(c1, c2) : max(r1, r2);
+    int n = across ? m_cols : m_rows;
+    auto isBlocked = [&](int k) {
+        return across ? blocked(r1, k) : blocked(k, c1);
+    };
+    for (int k = u; k <= v; k++)
+        if (isBlocked(k))
+            return 0;
+    int a = u;
+    while (a > 0  &&  !isBlocked(a - 1))
+        a--;
+    int b = v;
+    while (b < n - 1  &&  !isBlocked(b + 1))
+        b++;
+    int64_t total = 0;
+    for (int len = 1; len < int(m_afloat.size()); len++)
+    {
+        if (m_afloat[len] == 0)
+            continue;
+        int first = max(a, v - len + 1);
+        int last = min(u, b - len + 1);
+        if (last >= first)
+            total += int64_t(m_afloat[len]) * (last - first + 1);
+    }
+    return total;
+}
+
+void Heatmap::block(int r, int c)
+{
+    size_t i = index(r, c);
+    if (m_blocked[i])
+        return;
+    m_blocked[i] = 1;
+    countLine(index(r, 0), 1, m_cols, m_across);
+    countLine(index(0, c), m_cols, m_rows, m_down);
+}
+
+void Heatmap::sink(int length)
+{
+    if (length < 1  ||  length >= int(m_afloat.size())  ||  m_afloat[length] == 0)
+        return;
+    m_afloat[length]--;
+    countAll();
+}
+
+  // Recount the heat of the n cells start, start+stride, ... from the runs
+  // of unblocked cells among them
+void Heatmap::countLine(size_t start, size_t stride, int n, vector<int64_t>& heat)
+{
+    int k = 0;
+    while (k < n)
+    {
+        if (m_blocked[start + k * stride])
+        {
+            heat[start + k * stride] = 0;
+            k++;
+            continue;
+        }
+        int a = k;
+        while (k < n  &&  !m_blocked[start + k * stride])
+            k++;
+        int runLen = k - a;
+        for (int i = 0; i < runLen; i++)
+        {
+            int64_t h = 0;
+            for (int len = 1; len <= runLen  &&  len < int(m_afloat.size()); len++)
+                if (m_afloat[len] != 0)
+                    h += int64_t(m_afloat[len]) *
+                         (min(i, runLen - len) - max(0, i - len + 1) + 1);
+            heat[start + (a + i) * stride] = h;
+        }
+    }
+}
+
+void Heatmap::countAll()
+{
+    for (int r = 0; r < m_rows; r++)
+        countLine(index(r, 0), 1, m_cols, m_across);
+    for (int c = 0; c < m_cols; c++)
+        countLine(index(0, c), m_cols, m_rows, m_down);
+}
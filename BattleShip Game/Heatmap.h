@@ -0,0 +1,58 @@
+#ifndef HEATMAP_INCLUDED
+#define HEATMAP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Placement-count heatmaps for boards of any size.  The heat of a cell is
+// the number of ways a ship still afloat could lie across it without
+// covering a blocked cell -- a miss, or a hit on a ship already sunk.
+// Along a row or column, the placements of a ship of length L that cover
+// the cell at offset i of a run of n unblocked cells number
+// min(i, n-L) - max(0, i-L+1) + 1, so each run is counted in closed form:
+// one ship length costs O(cells), and blocking a cell recounts only that
+// cell's row and column.
+
+class Heatmap
+{
+  public:
+      // lengths is the fleet, one entry per ship
+    Heatmap(int rows, int cols, const std::vector<int>& lengths);
+
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    bool blocked(int r, int c) const { return m_blocked[index(r, c)]; }
+
+      // Placements of ships still afloat covering (r, c)
+    std::int64_t heat(int r, int c) const
+    {
+        std::size_t i = index(r, c);
+        return m_across[i] + m_down[i];
+    }
+
+      // Placements of ships still afloat, lying along the line from
+      // (r1, c1) to (r2, c2), that cover both; 0 unless the two share a row
+      // or column
+    std::int64_t coverings(int r1, int c1, int r2, int c2) const;
+
+      // No ship still afloat can cover (r, c)
+    void block(int r, int c);
+
+      // A ship of this length has been sunk
+    void sink(int length);
+
+  private:
+    std::size_t index(int r, int c) const { return std::size_t(r) * m_cols + c; }
+    void countLine(std::size_t start, std::size_t stride, int n,
+                   std::vector<std::int64_t>& heat);
+    void countAll();
+
+    int m_rows, m_cols;
+    std::vector<int> m_afloat;            // ships afloat, indexed by length
+    std::vector<char> m_blocked;
+    std::vector<std::int64_t> m_across;   // heat from placements along rows
+    std::vector<std::int64_t> m_down;     // ... and along columns
+};
+
+#endif // HEATMAP_INCLUDED
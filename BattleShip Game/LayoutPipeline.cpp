@@ -0,0 +1,138 @@
+#include "LayoutPipeline.h"
+#include "Board.h"
+#include "Game.h"
+#include "Player.h"
+#include "Stats.h"
+#include "Tournament.h"
+#include "Trace.h"
+#include "globals.h"
+#include <algorithm>
+
+using namespace std;
+
+//*********************************************************************
+//  LayoutRing
+//*********************************************************************
+
+LayoutRing::LayoutRing(int capacity, int nShips, long long first)
+ : m_capacity(capacity), m_nShips(nShips), m_slots(new Slot[capacity])
+{
+      // Each slot starts out free for the first game that maps to it
+    for (int i = 0; i < capacity; i++)
+    {
+        long long k = first + ((i - first % capacity) + capacity) % capacity;
+        m_slots[i].seq.store(2 * k, memory_order_relaxed);
+        m_slots[i].fleets.resize(2 * nShips);
+    }
+}
+
+void LayoutRing::put(long long k, const ShipPlacement* fleet1,
+                     const ShipPlacement* fleet2)
+{
+    Slot& s = m_slots[k % m_capacity];
+    while (s.seq.load(memory_order_acquire) != 2 * k)
+        this_thread::yield();
+    s.ok[0] = fleet1 != nullptr;
+    s.ok[1] = fleet2 != nullptr;
+    if (fleet1 != nullptr)
+        copy(fleet1, fleet1 + m_nShips, s.fleets.begin());
+    if (fleet2 != nullptr)
+        copy(fleet2, fleet2 + m_nShips, s.fleets.begin() + m_nShips);
+    s.seq.store(2 * k + 1, memory_order_release);
+}
+
+void LayoutRing::take(long long k, vector<ShipPlacement>& fleet1, bool& ok1,
+                      vector<ShipPlacement>& fleet2, bool& ok2)
+{
+    Slot& s = m_slots[k % m_capacity];
+    if (s.seq.load(memory_order_acquire) != 2 * k + 1)
+    {
+        STAT_ADD(STAT_LAYOUT_WAITS, 1);
+        while (s.seq.load(memory_order_acquire) != 2 * k + 1)
+            this_thread::yield();
+    }
+    ok1 = s.ok[0];
+    ok2 = s.ok[1];
+    fleet1.assign(s.fleets.begin(), s.fleets.begin() + m_nShips);
+    fleet2.assign(s.fleets.begin() + m_nShips, s.fleets.end());
+      // Hand the slot to the game capacity places later
+    s.seq.store(2 * (k + m_capacity), memory_order_release);
+}
+
+//*********************************************************************
+//  LayoutProducer
+//*********************************************************************
+
+namespace {
+
+int standardFleetSize(int rows, int cols)
+{
+    Game g(rows, cols);
+    addStandardShips(g);
+    return g.nShips();
+}
+
+  // Place a fleet the way a player of type would, and record where it went
+bool placeFleet(const Game& g, const string& type, vector<ShipPlacement>& fleet)
+{
+    Player* p = createPlayer(type, type, g);
+    Board b(g);
+    bool placed = false;
+    for (int attempt = 0; p != nullptr  &&  attempt < 50  &&  !placed; attempt++)
+    {
+        STAT_ADD(STAT_PLACE_ATTEMPTS, 1);
+        placed = p->placeShips(b);
+        if (!placed)
+            STAT_ADD(STAT_PLACE_FAILURES, 1);
+    }
+    delete p;
+    fleet.resize(g.nShips());
+    for (int k = 0; placed  &&  k < g.nShips(); k++)
+    {
+        Point topOrLeft;
+        Direction dir;
+        placed = b.shipPosition(k, topOrLeft, dir);
+        fleet[k] = ShipPlacement{ uint8_t(topOrLeft.r), uint8_t(topOrLeft.c),
+                                  uint8_t(dir == VERTICAL) };
+    }
+    return placed;
+}
+
+}  // namespace
+
+LayoutProducer::LayoutProducer(const string& type1, const string& type2,
+                               int rows, int cols, unsigned long long seed,
+                               long long first, long long end, int nWorkers,
+                               int capacity)
+ : m_type1(type1), m_type2(type2), m_rows(rows), m_cols(cols), m_seed(seed),
+   m_end(end), m_next(first), m_ring(capacity, standardFleetSize(rows, cols), first)
+{
+    for (int w = 0; w < nWorkers; w++)
+        m_threads.emplace_back(&LayoutProducer::produce, this, w);
+}
+
+LayoutProducer::~LayoutProducer()
+{
+    for (thread& t : m_threads)
+        t.join();
+}
+
+void LayoutProducer::produce(int worker)
+{
+    traceThreadName("layouts " + to_string(worker));
+    Game g(m_rows, m_cols);
+    addStandardShips(g);
+    vector<ShipPlacement> fleet1;
+    vector<ShipPlacement> fleet2;
+    for (;;)
+    {
+        long long k = m_next.fetch_add(1);
+        if (k >= m_end)
+            break;
+        TraceSpan span("layouts", k);
+        seedRandom(layoutSeed(m_seed, k));
+        bool ok1 = placeFleet(g, m_type1, fleet1);
+        bool ok2 = placeFleet(g, m_type2, fleet2);
+        m_ring.put(k, ok1 ? fleet1.data() : nullptr, ok2 ? fleet2.data() : nullptr);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef LAYOUTPIPELINE_INCLUDED
+#define LAYOUTPIPELINE_INCLUDED
+
+#include "Layouts.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fleet placement moved off the game threads.  Producer threads place the
+// fleets for games first .. end-1 ahead of play and publish them in a
+// bounded lock-free ring; game threads take the fleets for the game they
+// are about to play.  The fleets for game k depend only on (seed, k), so
+// results do not depend on how many producers or consumers there are.
+
+  // A bounded ring of fleet pairs, one slot per game in flight.  Game k
+  // always uses slot k % capacity, and a per-slot sequence number says
+  // whether the slot is waiting for game k's producer or its consumer, so
+  // neither side takes a lock.
+class LayoutRing
+{
+  public:
+      // For games first, first+1, ...
+    LayoutRing(int capacity, int nShips, long long first);
+
+      // Block until slot k is free, then store both fleets of game k;
+      // nullptr means that side could not place its fleet
+    void put(long long k, const ShipPlacement* fleet1, const ShipPlacement* fleet2);
+
+      // Block until game k's fleets are in the ring, copy them out and free
+      // the slot.  Returns false for either side that had no fleet.
+    void take(long long k, std::vector<ShipPlacement>& fleet1, bool& ok1,
+              std::vector<ShipPlacement>& fleet2, bool& ok2);
+
+    LayoutRing(const LayoutRing&) = delete;
+    LayoutRing& operator=(const LayoutRing&) = delete;
+
+  private:
+    struct Slot
+    {
+          // 2k while free for game k's producer, 2k+1 once k is stored
+        std::atomic<long long> seq;
+        bool ok[2];
+        std::vector<ShipPlacement> fleets;     // 2 * nShips
+    };
+
+    const int m_capacity;
+    const int m_nShips;
+    std::unique_ptr<Slot[]> m_slots;
+};
+
+  // Producer threads filling a LayoutRing for games first .. end-1 of a
+  // series between type1 and type2 on a rows x cols board with the
+  // standard fleet
+class LayoutProducer
+{
+  public:
+    LayoutProducer(const std::string& type1, const std::string& type2,
+                   int rows, int cols, unsigned long long seed,
+                   long long first, long long end, int nWorkers, int capacity);
+    ~LayoutProducer();      // stops the producers once every game is taken
+
+    LayoutRing& ring() { return m_ring; }
+
+    LayoutProducer(const LayoutProducer&) = delete;
+    LayoutProducer& operator=(const LayoutProducer&) = delete;
+
+  private:
+    void produce(int worker);
+
+    std::string m_type1;
+    std::string m_type2;
+    int m_rows;
+    int m_cols;
+    unsigned long long m_seed;
+    long long m_end;
+    std::atomic<long long> m_next;
+    LayoutRing m_ring;
+    std::vector<std::thread> m_threads;
+};
+
+#endif // LAYOUTPIPELINE_INCLUDED
@@ -0,0 +1,454 @@
+#include "Layouts.h"
+#include "Board.h"
+#include "Game.h"
+#include "Player.h"
+#include "Stats.h"
+#include "Tournament.h"
+#include "globals.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = { 'B', 'S', 'L', 'A', 'Y', 'O', 'U', 'T' };
+const uint32_t VERSION = 1;
+
+size_t paddedLengths(size_t nShips)
+{
+    return (nShips + 7) / 8 * 8;
+}
+
+}  // namespace
+
+//*********************************************************************
+//  LayoutCorpus
+//*********************************************************************
+
+LayoutCorpus::LayoutCorpus()
+ : m_data(nullptr), m_length(0), m_mapped(false), m_header(nullptr),
+   m_lengths(nullptr), m_records(nullptr), m_count(0)
+{}
+
+LayoutCorpus::~LayoutCorpus()
+{
+    close();
+}
+
+void LayoutCorpus::close()
+{
+#ifndef _WIN32
+    if (m_mapped)
+        munmap(const_cast<char*>(m_data), m_length);
+#endif
+    m_copy.clear();
+    m_data = nullptr;
+    m_length = 0;
+    m_mapped = false;
+    m_count = 0;
+}
+
+bool LayoutCorpus::open(const string& path, string& error)
+{
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0  &&  fstat(fd, &st) == 0  &&  st.st_size > 0)
+    {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            m_data = static_cast<const char*>(p);
+            m_length = st.st_size;
+            m_mapped = true;
+        }
+    }
+    if (fd >= 0)
+        ::close(fd);
+#endif
+    if (!m_mapped)
+    {
+        ifstream in(path, ios::binary);
+        if (!in)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        m_copy.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        m_data = m_copy.data();
+        m_length = m_copy.size();
+    }
+
+    m_header = reinterpret_cast<const LayoutFileHeader*>(m_data);
+    if (m_length < sizeof(LayoutFileHeader)  ||
+        memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error = path + " is not a layout corpus";
+        close();
+        return false;
+    }
+    if (m_header->version != VERSION)
+    {
+        error = path + " has unsupported version " + to_string(m_header->version);
+        close();
+        return false;
+    }
+    size_t nShips = m_header->nShips;
+    size_t offset = sizeof(LayoutFileHeader) + paddedLengths(nShips);
+    if (nShips == 0  ||  m_length < offset  ||
+        (m_length - offset) / (nShips * sizeof(ShipPlacement)) < m_header->count)
+    {
+        error = path + " is truncated";
+        close();
+        return false;
+    }
+    m_lengths = reinterpret_cast<const uint8_t*>(m_data + sizeof(LayoutFileHeader));
+    m_records = reinterpret_cast<const ShipPlacement*>(m_data + offset);
+    m_count = m_header->count;
+    return true;
+}
+
+bool LayoutCorpus::matches(const Game& g) const
+{
+    if (m_count == 0  &&  m_data == nullptr)
+        return false;
+    if (g.rows() != rows()  ||  g.cols() != cols()  ||  g.nShips() != nShips())
+        return false;
+    for (int k = 0; k < nShips(); k++)
+        if (g.shipLength(k) != shipLength(k))
+            return false;
+    return true;
+}
+
+//*********************************************************************
+//  Generating and playing layouts
+//*********************************************************************
+
+bool generateLayouts(const string& path, const Game& g, const string& placer,
+                     long long count, unsigned long long seed, string& error)
+{
+    LayoutFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.rows = g.rows();
+    header.cols = g.cols();
+    header.nShips = g.nShips();
+    header.count = count;
+
+    string tmp = path + ".tmp";
+    ofstream out(tmp, ios::binary);
+    if (!out)
+    {
+        error = "cannot write " + tmp;
+        return false;
+    }
+      // Never leave a partial corpus behind
+    auto fail = [&](const string& why) {
+        out.close();
+        remove(tmp.c_str());
+        error = why;
+        return false;
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    vector<uint8_t> lengths(paddedLengths(g.nShips()), 0);
+    for (int k = 0; k < g.nShips(); k++)
+        lengths[k] = g.shipLength(k);
+    out.write(reinterpret_cast<const char*>(lengths.data()), lengths.size());
+
+    vector<ShipPlacement> record(g.nShips());
+    for (long long i = 0; i < count; i++)
+    {
+        seedRandom(gameSeed(seed, i));
+        unique_ptr<Player> p(createPlayer(placer, placer, g));
+        if (p == nullptr  ||  p->isHuman())
+            return fail("cannot place fleets with player type " + placer);
+        Board b(g);
+        bool placed = false;
+        for (int attempt = 0; attempt < 50  &&  !placed; attempt++)
+            placed = p->placeShips(b);
+        for (int k = 0; placed  &&  k < g.nShips(); k++)
+        {
+            Point topOrLeft;
+            Direction dir;
+            placed = b.shipPosition(k, topOrLeft, dir);
+            record[k] = ShipPlacement{ uint8_t(topOrLeft.r), uint8_t(topOrLeft.c),
+                                       uint8_t(dir == VERTICAL) };
+        }
+        if (!placed)
+            return fail(placer + " could not place layout " + to_string(i));
+        out.write(reinterpret_cast<const char*>(record.data()),
+                  record.size() * sizeof(ShipPlacement));
+    }
+    out.close();
+    if (!out  ||  rename(tmp.c_str(), path.c_str()) != 0)
+        return fail("cannot write " + path);
+    return true;
+}
+
+bool placeLayout(Board& b, const ShipPlacement* layout, int nShips)
+{
+    b.clear();
+    for (int k = 0; k < nShips; k++)
+        if (!b.placeShip(Point(layout[k].r, layout[k].c), k,
+                         layout[k].vertical ? VERTICAL : HORIZONTAL))
+            return false;
+    return true;
+}
+
+int shotsToSink(const Game& g, Player* attacker, const ShipPlacement* layout,
+                int maxShots)
+{
+    Board b(g);
+    if (!placeLayout(b, layout, g.nShips()))
+        return -1;
+    attacker->setOpponentView(&b.shotView());
+    int result = -1;
+    for (int shots = 1; shots <= maxShots  &&  result < 0; shots++)
+    {
+        Point p = attacker->recommendAttack();
+        bool shotHit = false;
+        bool shipDestroyed = false;
+        int shipId = -1;
+        bool valid = b.attack(p, shotHit, shipDestroyed, shipId);
+        STAT_ADD(STAT_SHOTS, 1);
+        if (!valid)
+            STAT_ADD(STAT_WASTED_SHOTS, 1);
+        attacker->recordAttackResult(p, valid, shotHit, shipDestroyed, shipId);
+        if (valid  &&  shotHit  &&  b.allShipsDestroyed())
+            result = shots;
+    }
+    attacker->setOpponentView(nullptr);
+    return result;
+}
+
+//*********************************************************************
+//  layouts command
+//*********************************************************************
+
+namespace {
+
+struct Moments
+{
+    long long n = 0;
+    double sum = 0;
+    double sumSq = 0;
+    void add(double x) { n++; sum += x; sumSq += x * x; }
+    double mean() const { return n == 0 ? 0 : sum / n; }
+    double variance() const
+    {
+        return n < 2 ? 0 : (sumSq - sum * sum / n) / (n - 1);
+    }
+      // Half-width of the 95% confidence interval for the mean
+    double halfWidth() const { return n == 0 ? 0 : 1.96 * sqrt(variance() / n); }
+};
+
+vector<string> splitList(const string& s)
+{
+    vector<string> items;
+    istringstream iss(s);
+    string item;
+    while (getline(iss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+int generateMain(int argc, char* argv[])
+{
+    string out;
+    string placer = "good";
+    long long count = 10000;
+    unsigned long long seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string arg = argv[i];
+        string value = argv[i + 1];
+        if (arg == "--out")
+            out = value;
+        else if (arg == "--placer")
+            placer = value;
+        else if (arg == "--count")
+            count = atoll(value.c_str());
+        else if (arg == "--seed")
+            seed = strtoull(value.c_str(), nullptr, 10);
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            return 2;
+        }
+    }
+    if (argc % 2 == 0  ||  out.empty()  ||  count < 0)
+    {
+        cerr << "usage: layouts generate --out FILE [--count N] [--placer TYPE]"
+             << " [--seed S]" << endl;
+        return 2;
+    }
+    Game g(10, 10);
+    addStandardShips(g);
+    string error;
+    if (!generateLayouts(out, g, placer, count, seed, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    cout << "Wrote " << count << " layouts to " << out << endl;
+    return 0;
+}
+
+int evalMain(int argc, char* argv[])
+{
+    string corpusPath;
+    vector<string> types = { "good", "mediocre" };
+    unsigned long long seed = 1;
+    int nThreads = 0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string arg = argv[i];
+        string value = argv[i + 1];
+        if (arg == "--corpus")
+            corpusPath = value;
+        else if (arg == "--types")
+            types = splitList(value);
+        else if (arg == "--seed")
+            seed = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads")
+            nThreads = atoi(value.c_str());
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            return 2;
+        }
+    }
+    if (argc % 2 == 0  ||  corpusPath.empty()  ||  types.empty())
+    {
+        cerr << "usage: layouts eval --corpus FILE [--types T1,T2,...]"
+             << " [--seed S] [--threads N]" << endl;
+        return 2;
+    }
+
+    LayoutCorpus corpus;
+    string error;
+    if (!corpus.open(corpusPath, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    Game g(corpus.rows(), corpus.cols());
+    addStandardShips(g);
+    if (!corpus.matches(g))
+    {
+        cerr << corpusPath << " was not made for the standard fleet" << endl;
+        return 1;
+    }
+    for (const string& t : types)
+    {
+        unique_ptr<Player> p(createPlayer(t, t, g));
+        if (p == nullptr  ||  p->isHuman())
+        {
+            cerr << "Cannot evaluate player type " << t << endl;
+            return 2;
+        }
+    }
+
+      // Every type attacks layout i with the generator seeded from (seed, i).
+      // A sane strategy sinks the fleet in at most rows*cols valid shots;
+      // the cap stops one that keeps wasting shots.
+    const long long n = corpus.size();
+    const int maxShots = 2 * g.rows() * g.cols();
+    vector<vector<int>> shots(types.size(), vector<int>(n));
+    if (nThreads <= 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+    atomic<long long> next(0);
+    vector<thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back([&]() {
+            const long long CHUNK = 64;
+            for (;;)
+            {
+                long long first = next.fetch_add(CHUNK);
+                if (first >= n)
+                    break;
+                for (long long i = first; i < min(first + CHUNK, n); i++)
+                    for (size_t t = 0; t < types.size(); t++)
+                    {
+                        seedRandom(gameSeed(seed, i));
+                        unique_ptr<Player> p(createPlayer(types[t], types[t], g));
+                        shots[t][i] = shotsToSink(g, p.get(), corpus.layout(i),
+                                                  maxShots);
+                    }
+            }
+        });
+    for (thread& w : workers)
+        w.join();
+
+    cout << "Layouts: " << n << " (" << g.rows() << "x" << g.cols() << ", "
+         << g.nShips() << " ships)" << endl;
+    cout << fixed << setprecision(2);
+    vector<Moments> alone(types.size());
+    for (size_t t = 0; t < types.size(); t++)
+    {
+        long long unfinished = 0;
+        for (long long i = 0; i < n; i++)
+        {
+            if (shots[t][i] < 0)
+                unfinished++;
+            else
+                alone[t].add(shots[t][i]);
+        }
+        cout << "  " << left << setw(12) << types[t] << right
+             << " mean shots " << alone[t].mean() << " +/- " << alone[t].halfWidth();
+        if (unfinished > 0)
+            cout << " (" << unfinished << " unfinished)";
+        cout << endl;
+    }
+
+      // Differences on the same layouts have far less variance than
+      // differences between independent samples
+    for (size_t t = 1; t < types.size(); t++)
+    {
+        Moments diff;
+        for (long long i = 0; i < n; i++)
+            if (shots[0][i] >= 0  &&  shots[t][i] >= 0)
+                diff.add(shots[t][i] - shots[0][i]);
+        cout << "  " << types[t] << " - " << types[0] << ": " << showpos
+             << diff.mean() << noshowpos << " +/- " << diff.halfWidth()
+             << " shots";
+        if (diff.variance() > 0)
+            cout << " (unpaired/paired variance "
+                 << (alone[0].variance() + alone[t].variance()) / diff.variance()
+                 << ")";
+        cout << endl;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int layoutsMain(int argc, char* argv[])
+{
+    string sub = argc > 1 ? argv[1] : "";
+    if (sub == "generate")
+        return generateMain(argc - 1, argv + 1);
+    if (sub == "eval")
+        return evalMain(argc - 1, argv + 1);
+    cerr << "usage: layouts generate|eval [options]" << endl;
+    return 2;
+}
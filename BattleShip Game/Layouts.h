@@ -0,0 +1,95 @@
+#ifndef LAYOUTS_INCLUDED
+#define LAYOUTS_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Board;
+class Game;
+class Player;
+
+// Fixed corpora of fleet layouts.  Evaluating every targeting strategy
+// against the same layouts, with the same random numbers per layout,
+// removes most of the game-to-game noise from comparisons between them
+// (common random numbers).
+//
+// A corpus file is a 32-byte header, the fleet's ship lengths padded to a
+// multiple of 8 bytes, and then one fixed-size record per layout holding a
+// ShipPlacement for each ship.  Integers are stored in host byte order.
+
+struct ShipPlacement
+{
+    std::uint8_t r;
+    std::uint8_t c;
+    std::uint8_t vertical;
+};
+
+struct LayoutFileHeader
+{
+    char magic[8];              // "BSLAYOUT"
+    std::uint32_t version;      // 1
+    std::uint16_t rows;
+    std::uint16_t cols;
+    std::uint32_t nShips;
+    std::uint32_t reserved;
+    std::uint64_t count;        // number of layouts
+};
+
+  // A read-only view of a corpus file, memory-mapped where the platform
+  // allows it
+class LayoutCorpus
+{
+  public:
+    LayoutCorpus();
+    ~LayoutCorpus();
+    bool open(const std::string& path, std::string& error);
+
+    long long size() const { return m_count; }
+    int rows() const { return m_header->rows; }
+    int cols() const { return m_header->cols; }
+    int nShips() const { return m_header->nShips; }
+    int shipLength(int shipId) const { return m_lengths[shipId]; }
+      // nShips() placements, indexed by ship id
+    const ShipPlacement* layout(long long i) const
+    {
+        return m_records + i * m_header->nShips;
+    }
+      // Whether g has the board size and fleet this corpus was made for
+    bool matches(const Game& g) const;
+
+    LayoutCorpus(const LayoutCorpus&) = delete;
+    LayoutCorpus& operator=(const LayoutCorpus&) = delete;
+
+  private:
+    void close();
+
+    const char* m_data;
+    std::size_t m_length;
+    bool m_mapped;
+    std::vector<char> m_copy;           // used when the file is not mapped
+    const LayoutFileHeader* m_header;
+    const std::uint8_t* m_lengths;
+    const ShipPlacement* m_records;
+    long long m_count;
+};
+
+  // Write count layouts made by placer-type players to path.  Layout k is
+  // drawn with the generator seeded from (seed, k).
+bool generateLayouts(const std::string& path, const Game& g,
+                     const std::string& placer, long long count,
+                     unsigned long long seed, std::string& error);
+
+  // Place the ships of layout on an empty board
+bool placeLayout(Board& b, const ShipPlacement* layout, int nShips);
+
+  // Let attacker fire at layout until every ship is sunk.  Returns the
+  // number of shots, or -1 if the fleet still stood after maxShots.
+int shotsToSink(const Game& g, Player* attacker, const ShipPlacement* layout,
+                int maxShots);
+
+  // Entry point for "battleship layouts generate|eval [options]"
+int layoutsMain(int argc, char* argv[]);
+
+#endif // LAYOUTS_INCLUDED
@@ -0,0 +1,447 @@
+#include "League.h"
+#include "Game.h"
+#include "Player.h"
+#include "Tournament.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const long long CHUNK = 8;      // games a worker plays between looks at its deque
+
+  // Games [first, end) of one pairing
+struct Run
+{
+    int pairing;
+    long long first;
+    long long end;
+};
+
+struct WorkerQueue
+{
+    mutex m;
+    deque<Run> runs;
+};
+
+  // Up to CHUNK games from the back run of q
+bool takeOwn(WorkerQueue& q, Run& run)
+{
+    lock_guard<mutex> lock(q.m);
+    if (q.runs.empty())
+        return false;
+    Run& back = q.runs.back();
+    run = { back.pairing, back.first, min(back.first + CHUNK, back.end) };
+    back.first = run.end;
+    if (back.first == back.end)
+        q.runs.pop_back();
+    return true;
+}
+
+  // The front run of victim, or the back half of it if it is the only one
+bool steal(WorkerQueue& victim, Run& run)
+{
+    lock_guard<mutex> lock(victim.m);
+    if (victim.runs.empty())
+        return false;
+    Run& front = victim.runs.front();
+    if (victim.runs.size() > 1  ||  front.end - front.first <= CHUNK)
+    {
+        run = front;
+        victim.runs.pop_front();
+        return true;
+    }
+    long long mid = front.first + (front.end - front.first) / 2;
+    run = { front.pairing, mid, front.end };
+    front.end = mid;
+    return true;
+}
+
+  // The seed of one pairing's series
+unsigned long long pairingSeed(unsigned long long seed, int pairing)
+{
+    return (static_cast<unsigned long long>(gameSeed(seed, pairing)) << 32) |
+           gameSeed(seed ^ 0xbb67ae8584caa73bULL, pairing);
+}
+
+template <typename T>
+vector<vector<T>> square(size_t n)
+{
+    return vector<vector<T>>(n, vector<T>(n, T()));
+}
+
+}  // namespace
+
+LeagueResult runLeague(const LeagueConfig& config)
+{
+    int nThreads = config.nThreads;
+    if (nThreads <= 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+    size_t n = config.types.size();
+
+    LeagueResult total;
+    total.types = config.types;
+    total.wins = square<long long>(n);
+    total.games = square<long long>(n);
+    total.seconds = square<double>(n);
+
+    vector<pair<int, int>> pairings;
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i + 1; j < n; j++)
+            pairings.push_back(make_pair(int(i), int(j)));
+
+      // Deal the pairings out to the workers' deques in turn
+    vector<WorkerQueue> queues(nThreads);
+    for (size_t p = 0; p < pairings.size(); p++)
+        queues[p % nThreads].runs.push_back({ int(p), 0, config.gamesPerPairing });
+    atomic<long long> remaining(static_cast<long long>(pairings.size()) *
+                                config.gamesPerPairing);
+    mutex totalMutex;
+
+    vector<thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back([&, t]() {
+            traceThreadName("worker " + to_string(t));
+            LeagueResult local;
+            local.wins = square<long long>(n);
+            local.games = square<long long>(n);
+            local.seconds = square<double>(n);
+            while (remaining.load() > 0)
+            {
+                Run run;
+                bool found = takeOwn(queues[t], run);
+                for (int v = 1; !found  &&  v < nThreads; v++)
+                    found = steal(queues[(t + v) % nThreads], run);
+                if (!found)
+                {
+                      // Every run left is being played; wait for the last
+                    this_thread::yield();
+                    continue;
+                }
+                if (run.end - run.first > CHUNK)
+                {
+                      // Keep all but the first chunk where others can steal it
+                    lock_guard<mutex> lock(queues[t].m);
+                    queues[t].runs.push_back({ run.pairing, run.first + CHUNK, run.end });
+                    run.end = run.first + CHUNK;
+                }
+
+                int i = pairings[run.pairing].first;
+                int j = pairings[run.pairing].second;
+                auto start = chrono::steady_clock::now();
+                Game g(config.rows, config.cols);
+                addStandardShips(g);
+                g.setShotsPerTurn(config.shotsPerTurn);
+                unsigned long long seed = pairingSeed(config.seed, run.pairing);
+                for (long long k = run.first; k < run.end; k++)
+                {
+                    GameRecord rec = playSeriesGame(g, config.types[i], config.types[j],
+                                                    seed, k);
+                    local.games[i][j]++;
+                    if (rec.winner == 1)
+                        local.wins[i][j]++;
+                    else if (rec.winner == 2)
+                        local.wins[j][i]++;
+                }
+                local.seconds[i][j] += chrono::duration<double>(
+                                           chrono::steady_clock::now() - start).count();
+                remaining -= run.end - run.first;
+            }
+            lock_guard<mutex> lock(totalMutex);
+            for (size_t i = 0; i < n; i++)
+                for (size_t j = 0; j < n; j++)
+                {
+                    total.wins[i][j] += local.wins[i][j];
+                    total.games[i][j] += local.games[i][j];
+                    total.seconds[i][j] += local.seconds[i][j];
+                }
+        });
+    for (thread& w : workers)
+        w.join();
+
+      // Make the tables symmetric
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = i + 1; j < n; j++)
+        {
+            total.games[j][i] = total.games[i][j];
+            total.seconds[j][i] = total.seconds[i][j];
+        }
+    return total;
+}
+
+vector<Rating> rateLeague(const LeagueResult& r)
+{
+    size_t n = r.types.size();
+    vector<Rating> ratings(n, Rating{ 1500, 0 });
+    if (n < 2)
+        return ratings;
+
+      // Decisive games between each pair, plus the virtual one
+    vector<vector<double>> played = square<double>(n);
+    vector<double> won(n, 0);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            if (i != j)
+            {
+                played[i][j] = r.wins[i][j] + r.wins[j][i] + 1;
+                won[i] += r.wins[i][j] + 0.5;
+            }
+
+      // Hunter's MM iteration for the maximum-likelihood strengths,
+      // normalized to geometric mean 1
+    vector<double> gamma(n, 1);
+    for (int iter = 0; iter < 10000; iter++)
+    {
+        vector<double> next(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            double denom = 0;
+            for (size_t j = 0; j < n; j++)
+                if (i != j)
+                    denom += played[i][j] / (gamma[i] + gamma[j]);
+            next[i] = won[i] / denom;
+        }
+        double logMean = 0;
+        for (size_t i = 0; i < n; i++)
+            logMean += log(next[i]) / n;
+        double change = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            next[i] /= exp(logMean);
+            change = max(change, fabs(log(next[i] / gamma[i])));
+        }
+        gamma = next;
+        if (change < 1e-12)
+            break;
+    }
+
+      // The Fisher information in the log-strengths is a Laplacian, singular
+      // along the all-ones direction the normalization fixes; with J the
+      // all-ones matrix, its pseudo-inverse is (H + J/n)^-1 - J/n.
+      // Invert H + J/n by Gauss-Jordan elimination.
+    vector<vector<double>> a(n, vector<double>(n, 1.0 / n));
+    vector<vector<double>> inv = square<double>(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        inv[i][i] = 1;
+        for (size_t j = 0; j < n; j++)
+        {
+            if (i == j)
+                continue;
+            double p = gamma[i] / (gamma[i] + gamma[j]);
+            double info = played[i][j] * p * (1 - p);
+            a[i][j] -= info;
+            a[i][i] += info;
+        }
+    }
+    for (size_t col = 0; col < n; col++)
+    {
+        size_t pivot = col;
+        for (size_t row = col + 1; row < n; row++)
+            if (fabs(a[row][col]) > fabs(a[pivot][col]))
+                pivot = row;
+        swap(a[col], a[pivot]);
+        swap(inv[col], inv[pivot]);
+        double d = a[col][col];
+        for (size_t j = 0; j < n; j++)
+        {
+            a[col][j] /= d;
+            inv[col][j] /= d;
+        }
+        for (size_t row = 0; row < n; row++)
+        {
+            if (row == col)
+                continue;
+            double f = a[row][col];
+            for (size_t j = 0; j < n; j++)
+            {
+                a[row][j] -= f * a[col][j];
+                inv[row][j] -= f * inv[col][j];
+            }
+        }
+    }
+
+    const double scale = 400 / log(10.0);
+    for (size_t i = 0; i < n; i++)
+    {
+        double variance = max(0.0, inv[i][i] - 1.0 / n);
+        ratings[i].elo = 1500 + scale * log(gamma[i]);
+        ratings[i].margin = 1.96 * scale * sqrt(variance);
+    }
+    return ratings;
+}
+
+namespace {
+
+vector<string> splitTypes(const string& s)
+{
+    vector<string> items;
+    istringstream iss(s);
+    string item;
+    while (getline(iss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+void printLeague(const LeagueConfig& config, const LeagueResult& r)
+{
+    size_t n = r.types.size();
+    vector<Rating> ratings = rateLeague(r);
+    vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+        return ratings[x].elo > ratings[y].elo;
+    });
+
+    size_t width = 4;
+    for (const string& t : r.types)
+        width = max(width, t.size());
+
+    cout << n << " types, " << n * (n - 1) / 2 << " pairings of "
+         << config.gamesPerPairing << " games" << endl << endl;
+    cout << "rank  " << left << setw(width) << "type" << right
+         << "     elo    95%     won  played" << endl;
+    cout << fixed << setprecision(0);
+    for (size_t k = 0; k < n; k++)
+    {
+        size_t i = order[k];
+        long long won = 0;
+        long long played = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            won += r.wins[i][j];
+            played += r.games[i][j];
+        }
+        cout << setw(4) << k + 1 << "  " << left << setw(width) << r.types[i]
+             << right << setw(8) << ratings[i].elo << "  +-" << setw(4)
+             << ratings[i].margin << setw(8) << won << setw(8) << played << endl;
+    }
+
+      // Percentage of games the row type won against the column type, then
+      // the cost of each pairing
+    for (int table = 0; table < 2; table++)
+    {
+        cout << endl << left << setw(width)
+             << (table == 0 ? "won %" : "ms/game") << right;
+        for (size_t j : order)
+            cout << "  " << setw(max<size_t>(6, r.types[j].size())) << r.types[j];
+        cout << endl;
+        cout << setprecision(table == 0 ? 1 : 3);
+        for (size_t i : order)
+        {
+            cout << left << setw(width) << r.types[i] << right;
+            for (size_t j : order)
+            {
+                cout << "  " << setw(max<size_t>(6, r.types[j].size()));
+                if (i == j  ||  r.games[i][j] == 0)
+                    cout << "-";
+                else if (table == 0)
+                    cout << 100.0 * r.wins[i][j] / r.games[i][j];
+                else
+                    cout << 1000 * r.seconds[i][j] / r.games[i][j];
+            }
+            cout << endl;
+        }
+    }
+    cout.unsetf(ios::floatfield);
+}
+
+}  // namespace
+
+int leagueMain(int argc, char* argv[])
+{
+    LeagueConfig config;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for " << arg << endl;
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--types")
+            config.types = splitTypes(value);
+        else if (arg == "--games")
+            config.gamesPerPairing = atoll(value.c_str());
+        else if (arg == "--seed")
+            config.seed = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads")
+            config.nThreads = atoi(value.c_str());
+        else if (arg == "--rows")
+            config.rows = atoi(value.c_str());
+        else if (arg == "--cols")
+            config.cols = atoi(value.c_str());
+        else if (arg == "--salvo")
+        {
+            config.shotsPerTurn = (value == "ships" ? SHOTS_PER_SHIP : atoi(value.c_str()));
+            if (value != "ships"  &&  config.shotsPerTurn < 1)
+            {
+                cerr << "--salvo takes a positive number of shots or \"ships\"" << endl;
+                return 2;
+            }
+        }
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            cerr << "usage: league [--types T1,T2,...] [--games N] [--seed S]"
+                 << " [--threads T] [--rows R] [--cols C] [--salvo K|ships]"
+                 << endl;
+            return 2;
+        }
+    }
+    if (config.gamesPerPairing < 1)
+    {
+        cerr << "Number of games must be >= 1" << endl;
+        return 2;
+    }
+
+    vector<string> available = playerTypes();
+    if (config.types.empty())
+    {
+          // Every type that plays without a person at the keyboard
+        Game g(config.rows, config.cols);
+        addStandardShips(g);
+        for (const string& t : available)
+        {
+            Player* p = createPlayer(t, t, g);
+            if (p != nullptr  &&  !p->isHuman())
+                config.types.push_back(t);
+            delete p;
+        }
+    }
+    for (const string& t : config.types)
+    {
+        if (find(available.begin(), available.end(), t) == available.end())
+        {
+            cerr << "Unknown player type " << t << "; available:";
+            for (const string& name : available)
+                cerr << " " << name;
+            cerr << endl;
+            return 2;
+        }
+    }
+    if (config.types.size() < 2)
+    {
+        cerr << "A league needs at least two player types" << endl;
+        return 2;
+    }
+
+    printLeague(config, runLeague(config));
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef LEAGUE_INCLUDED
+#define LEAGUE_INCLUDED
+
+#include <string>
+#include <vector>
+
+// Round-robin leagues.  Every player type plays every other a fixed number
+// of games, and the results are fitted with the Bradley-Terry model: type i
+// beats type j with probability g_i / (g_i + g_j).  Ratings are reported on
+// the Elo scale, 400 log10 g_i, shifted so that they average 1500.
+//
+// A pairing's games are seeded from (seed, pairing, k) alone, so the
+// results do not depend on how the games were spread over the threads.
+
+struct LeagueConfig
+{
+    std::vector<std::string> types;     // empty means every non-human type
+    int rows = 10;
+    int cols = 10;
+    int shotsPerTurn = 1;               // see Game::setShotsPerTurn
+    long long gamesPerPairing = 200;
+    unsigned long long seed = 1;
+    int nThreads = 0;                   // 0 means one per hardware thread
+};
+
+struct LeagueResult
+{
+    std::vector<std::string> types;
+      // wins[i][j] is the number of games type i won against type j;
+      // games[i][j] those the two played, unfinished ones included
+    std::vector<std::vector<long long>> wins;
+    std::vector<std::vector<long long>> games;
+      // seconds the workers spent on each pairing, summed over threads
+    std::vector<std::vector<double>> seconds;
+};
+
+struct Rating
+{
+    double elo;
+    double margin;      // half-width of the 95% confidence interval
+};
+
+  // Play every pairing of config's types on a pool of worker threads.
+  // Each worker keeps a deque of runs of games; it plays the runs it owns
+  // from the back and, when it runs out, steals from the front of another
+  // worker's deque, splitting the run in half when that is all there is.
+  // Pairings whose games cost far more than others' thus end up shared
+  // among all the threads instead of finishing on one.
+LeagueResult runLeague(const LeagueConfig& config);
+
+  // Fit Bradley-Terry ratings to r.  Each pairing gets one virtual game,
+  // split evenly, so that a type that won or lost every game still has a
+  // finite rating.  The margins come from the inverse of the Fisher
+  // information of the fitted ratings.
+std::vector<Rating> rateLeague(const LeagueResult& r);
+
+  // Entry point for "battleship league [options]"
+int leagueMain(int argc, char* argv[]);
+
+#endif // LEAGUE_INCLUDED
@@ -0,0 +1,664 @@
+#include "Occupancy.h"
+#include "Game.h"
+#include "Tournament.h"
+#include "globals.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+//*********************************************************************
+//  Bitboards
+//*********************************************************************
+
+  // Cell (r, c) is bit r*stride + c, with stride = cols + 1.  The padding
+  // column is never free, so a horizontal run of free cells cannot wrap
+  // onto the next row.
+struct Mask
+{
+    uint64_t w[2];
+};
+
+inline Mask operator&(Mask a, Mask b) { return Mask{ { a.w[0] & b.w[0], a.w[1] & b.w[1] } }; }
+inline Mask operator|(Mask a, Mask b) { return Mask{ { a.w[0] | b.w[0], a.w[1] | b.w[1] } }; }
+inline Mask operator~(Mask a) { return Mask{ { ~a.w[0], ~a.w[1] } }; }
+inline bool operator==(Mask a, Mask b) { return a.w[0] == b.w[0]  &&  a.w[1] == b.w[1]; }
+inline bool operator<(Mask a, Mask b)
+{
+    return a.w[1] != b.w[1] ? a.w[1] < b.w[1] : a.w[0] < b.w[0];
+}
+inline bool any(Mask a) { return (a.w[0] | a.w[1]) != 0; }
+inline bool test(Mask a, int bit) { return (a.w[bit >> 6] >> (bit & 63)) & 1; }
+inline void set(Mask& a, int bit) { a.w[bit >> 6] |= uint64_t(1) << (bit & 63); }
+
+  // Bit i of the result is bit i+s of a
+inline Mask shiftDown(Mask a, int s)
+{
+    if (s == 0)
+        return a;
+    if (s >= 64)
+        return Mask{ { a.w[1] >> (s - 64), 0 } };
+    return Mask{ { (a.w[0] >> s) | (a.w[1] << (64 - s)), a.w[1] >> s } };
+}
+
+  // Remove and return the lowest set bit
+inline int popLowest(Mask& a)
+{
+    if (a.w[0] != 0)
+    {
+        int bit = countr_zero(a.w[0]);
+        a.w[0] &= a.w[0] - 1;
+        return bit;
+    }
+    int bit = 64 + countr_zero(a.w[1]);
+    a.w[1] &= a.w[1] - 1;
+    return bit;
+}
+
+//*********************************************************************
+//  Enumerator
+//*********************************************************************
+
+struct Placement
+{
+    int ship;
+    int anchor;         // bit of the top or left cell
+    int dir;            // HORIZONTAL or VERTICAL, as in globals.h
+};
+
+class Enumerator
+{
+  public:
+    Enumerator(int rows, int cols, const vector<int>& lengths);
+
+    int nShips() const { return int(m_lengths.size()); }
+    int nCells() const { return m_rows * m_cols; }
+    Mask board() const { return m_board; }
+    Mask shipMask(int ship, int dir, int anchor) const
+    {
+        return m_shipMasks[(ship * 2 + dir) * 128 + anchor];
+    }
+      // Anchors at which ship fits in direction dir on the free cells
+    Mask legalAnchors(Mask free, int ship, int dir) const;
+
+      // Table index of a bit
+    int cellOf(int bit) const { return (bit / m_stride) * m_cols + bit % m_stride; }
+
+      // Count the layouts that extend placed (the ships before ship
+      // placed.size()) using the free cells, adding them to count and occ
+      // (nShips * nCells entries)
+    void search(Mask free, vector<Placement>& placed, uint64_t& count,
+                vector<uint64_t>& occ) const;
+
+  private:
+    void lastTwo(Mask free, const vector<Placement>& placed, uint64_t& count,
+                 vector<uint64_t>& occ) const;
+
+    int m_rows;
+    int m_cols;
+    int m_stride;
+    vector<int> m_lengths;
+    Mask m_board;
+    vector<Mask> m_shipMasks;
+};
+
+Enumerator::Enumerator(int rows, int cols, const vector<int>& lengths)
+ : m_rows(rows), m_cols(cols), m_stride(cols + 1), m_lengths(lengths),
+   m_board{ { 0, 0 } }, m_shipMasks(lengths.size() * 2 * 128, Mask{ { 0, 0 } })
+{
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < cols; c++)
+            set(m_board, r * m_stride + c);
+    for (int s = 0; s < nShips(); s++)
+        for (int dir = 0; dir < 2; dir++)
+        {
+            int step = (dir == 0 ? 1 : m_stride);
+            for (int anchor = 0; anchor + (lengths[s] - 1) * step < 128; anchor++)
+            {
+                Mask m{ { 0, 0 } };
+                for (int k = 0; k < lengths[s]; k++)
+                    set(m, anchor + k * step);
+                m_shipMasks[(s * 2 + dir) * 128 + anchor] = m;
+            }
+        }
+}
+
+Mask Enumerator::legalAnchors(Mask free, int ship, int dir) const
+{
+    int step = (dir == 0 ? 1 : m_stride);
+    Mask a = free;
+    for (int k = 1; k < m_lengths[ship]  &&  any(a); k++)
+        a = a & shiftDown(free, k * step);
+    return a;
+}
+
+void Enumerator::search(Mask free, vector<Placement>& placed, uint64_t& count,
+                        vector<uint64_t>& occ) const
+{
+    int ship = int(placed.size());
+    if (ship + 2 >= nShips())
+    {
+        lastTwo(free, placed, count, occ);
+        return;
+    }
+    for (int dir = 0; dir < 2; dir++)
+    {
+        Mask anchors = legalAnchors(free, ship, dir);
+        while (any(anchors))
+        {
+            int anchor = popLowest(anchors);
+            placed.push_back(Placement{ ship, anchor, dir });
+            search(free & ~shipMask(ship, dir, anchor), placed, count, occ);
+            placed.pop_back();
+        }
+    }
+}
+
+  // The last two ships are counted without enumerating their pairs.  With
+  // A and B the placements of ships a and b on the free cells, the pairs
+  // that do not overlap number |A||B| minus the overlapping ones.  A
+  // placement of a overlaps a perpendicular placement of b in at most one
+  // cell, so those overlaps are a sum of per-cell coverage counts; the
+  // parallel ones are few enough to test one by one.
+void Enumerator::lastTwo(Mask free, const vector<Placement>& placed,
+                         uint64_t& count, vector<uint64_t>& occ) const
+{
+    const int n = nShips();
+    const int cells = nCells();
+    uint64_t found = 0;
+
+    if (n - int(placed.size()) == 1)
+    {
+        for (int dir = 0; dir < 2; dir++)
+        {
+            Mask anchors = legalAnchors(free, n - 1, dir);
+            while (any(anchors))
+            {
+                Mask m = shipMask(n - 1, dir, popLowest(anchors));
+                found++;
+                while (any(m))
+                    occ[(n - 1) * cells + cellOf(popLowest(m))]++;
+            }
+        }
+    }
+    else if (n - int(placed.size()) == 2)
+    {
+        const int ships[2] = { n - 2, n - 1 };
+        Mask anchors[2][2];
+        uint64_t total[2] = { 0, 0 };
+        int cover[2][2][128];       // [ship][dir][bit]: placements covering bit
+        for (int s = 0; s < 2; s++)
+            for (int dir = 0; dir < 2; dir++)
+            {
+                anchors[s][dir] = legalAnchors(free, ships[s], dir);
+                fill(cover[s][dir], cover[s][dir] + 128, 0);
+                Mask a = anchors[s][dir];
+                while (any(a))
+                {
+                    Mask m = shipMask(ships[s], dir, popLowest(a));
+                    total[s]++;
+                    while (any(m))
+                        cover[s][dir][popLowest(m)]++;
+                }
+            }
+
+        for (int s = 0; s < 2; s++)
+        {
+            int o = 1 - s;
+            int len = m_lengths[ships[s]];
+            int otherLen = m_lengths[ships[o]];
+            for (int dir = 0; dir < 2; dir++)
+            {
+                int step = (dir == 0 ? 1 : m_stride);
+                Mask a = anchors[s][dir];
+                while (any(a))
+                {
+                    int anchor = popLowest(a);
+                    int r = anchor / m_stride;
+                    int c = anchor % m_stride;
+                    uint64_t overlaps = 0;
+                    for (int k = 0; k < len; k++)
+                        overlaps += cover[o][1 - dir][anchor + k * step];
+                    for (int t = 1 - otherLen; t < len; t++)
+                    {
+                        int along = (dir == 0 ? c : r) + t;
+                        int limit = (dir == 0 ? m_cols : m_rows) - otherLen;
+                        if (along >= 0  &&  along <= limit  &&
+                            test(anchors[o][dir], anchor + t * step))
+                            overlaps++;
+                    }
+                    uint64_t partners = total[o] - overlaps;
+                    if (s == 0)
+                        found += partners;
+                    Mask m = shipMask(ships[s], dir, anchor);
+                    while (any(m))
+                        occ[ships[s] * cells + cellOf(popLowest(m))] += partners;
+                }
+            }
+        }
+    }
+    else
+        found = 1;      // no ships at all
+
+    count += found;
+    for (const Placement& p : placed)
+    {
+        Mask m = shipMask(p.ship, p.dir, p.anchor);
+        while (any(m))
+            occ[p.ship * cells + cellOf(popLowest(m))] += found;
+    }
+}
+
+//*********************************************************************
+//  Symmetry
+//*********************************************************************
+
+  // Map cell (r, c) of a rows x cols board under symmetry t; transforms 4
+  // to 7 transpose the board and exist only when it is square
+void transform(int t, int rows, int cols, int r, int c, int& tr, int& tc)
+{
+    if (t >= 4)
+    {
+        swap(r, c);
+        swap(rows, cols);
+    }
+    tr = (t & 2) ? rows - 1 - r : r;
+    tc = (t & 1) ? cols - 1 - c : c;
+}
+
+struct WorkItem
+{
+    int anchor0;
+    int dir0;
+    int anchor1;        // -1 if ship 1 is left to the search
+    int dir1;
+    vector<int> images;     // symmetries mapping ship 0 to distinct places
+};
+
+}  // namespace
+
+//*********************************************************************
+//  enumerateLayouts
+//*********************************************************************
+
+bool enumerateLayouts(int rows, int cols, const vector<int>& lengths,
+                      int nThreads, bool useSymmetry, OccupancyTable& table,
+                      string& error)
+{
+    if (rows < 1  ||  cols < 1  ||  rows * (cols + 1) > 128)
+    {
+        error = "the board must fit in 128 bits with one padding column";
+        return false;
+    }
+    for (int len : lengths)
+        if (len < 1)
+        {
+            error = "ship lengths must be positive";
+            return false;
+        }
+
+    Enumerator e(rows, cols, lengths);
+    const int n = e.nShips();
+    const int cells = e.nCells();
+    table.rows = rows;
+    table.cols = cols;
+    table.lengths = lengths;
+    table.total = 0;
+    table.counts.assign(size_t(n) * cells, 0);
+    if (n < 3)
+    {
+        vector<Placement> placed;
+        e.search(e.board(), placed, table.total, table.counts);
+        return true;
+    }
+
+      // Work items: one placement of ship 0 per symmetry orbit, split
+      // further by the placement of ship 1 when more ships follow
+    int nSym = (!useSymmetry ? 1 : rows == cols ? 8 : 4);
+    vector<WorkItem> items;
+    for (int dir0 = 0; dir0 < 2; dir0++)
+    {
+        Mask anchors0 = e.legalAnchors(e.board(), 0, dir0);
+        while (any(anchors0))
+        {
+            int anchor0 = popLowest(anchors0);
+            Mask m0 = e.shipMask(0, dir0, anchor0);
+
+              // The images of ship 0 under each symmetry; skip this
+              // placement unless it is the least of its orbit
+            vector<Mask> seen;
+            vector<int> images;
+            bool canonical = true;
+            for (int t = 0; t < nSym; t++)
+            {
+                Mask img{ { 0, 0 } };
+                Mask m = m0;
+                while (any(m))
+                {
+                    int bit = popLowest(m);
+                    int tr, tc;
+                    transform(t, rows, cols, bit / (cols + 1), bit % (cols + 1), tr, tc);
+                    set(img, tr * (cols + 1) + tc);
+                }
+                if (img < m0)
+                    canonical = false;
+                if (find(seen.begin(), seen.end(), img) == seen.end())
+                {
+                    seen.push_back(img);
+                    images.push_back(t);
+                }
+            }
+            if (!canonical)
+                continue;
+
+            if (n == 3)
+            {
+                items.push_back(WorkItem{ anchor0, dir0, -1, 0, images });
+                continue;
+            }
+            Mask free = e.board() & ~m0;
+            for (int dir1 = 0; dir1 < 2; dir1++)
+            {
+                Mask anchors1 = e.legalAnchors(free, 1, dir1);
+                while (any(anchors1))
+                    items.push_back(WorkItem{ anchor0, dir0, popLowest(anchors1),
+                                              dir1, images });
+            }
+        }
+    }
+
+    if (nThreads <= 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+    atomic<size_t> next(0);
+    mutex totalMutex;
+    vector<thread> workers;
+    for (int w = 0; w < nThreads; w++)
+        workers.emplace_back([&]() {
+            uint64_t localTotal = 0;
+            vector<uint64_t> localCounts(size_t(n) * cells, 0);
+            vector<uint64_t> occ(size_t(n) * cells);
+            vector<Placement> placed;
+            for (;;)
+            {
+                size_t i = next.fetch_add(1);
+                if (i >= items.size())
+                    break;
+                const WorkItem& item = items[i];
+                Mask free = e.board() & ~e.shipMask(0, item.dir0, item.anchor0);
+                placed.assign(1, Placement{ 0, item.anchor0, item.dir0 });
+                if (item.anchor1 >= 0)
+                {
+                    free = free & ~e.shipMask(1, item.dir1, item.anchor1);
+                    placed.push_back(Placement{ 1, item.anchor1, item.dir1 });
+                }
+                uint64_t count = 0;
+                fill(occ.begin(), occ.end(), 0);
+                e.search(free, placed, count, occ);
+
+                  // The subtree of each image is the image of this subtree
+                for (int t : item.images)
+                {
+                    localTotal += count;
+                    for (int r = 0; r < rows; r++)
+                        for (int c = 0; c < cols; c++)
+                        {
+                            int tr, tc;
+                            transform(t, rows, cols, r, c, tr, tc);
+                            for (int s = 0; s < n; s++)
+                                localCounts[s * cells + tr * cols + tc] +=
+                                    occ[s * cells + r * cols + c];
+                        }
+                }
+            }
+            lock_guard<mutex> lock(totalMutex);
+            table.total += localTotal;
+            for (size_t k = 0; k < localCounts.size(); k++)
+                table.counts[k] += localCounts[k];
+        });
+    for (thread& w : workers)
+        w.join();
+    return true;
+}
+
+//*********************************************************************
+//  OccupancyTable
+//*********************************************************************
+
+uint64_t OccupancyTable::cellCount(int r, int c) const
+{
+    uint64_t sum = 0;
+    for (size_t s = 0; s < lengths.size(); s++)
+        sum += shipCount(int(s), r, c);
+    return sum;
+}
+
+bool OccupancyTable::matches(const Game& g) const
+{
+    if (g.rows() != rows  ||  g.cols() != cols  ||  g.nShips() != int(lengths.size()))
+        return false;
+    for (int k = 0; k < g.nShips(); k++)
+        if (g.shipLength(k) != lengths[k])
+            return false;
+    return true;
+}
+
+namespace {
+
+  // File layout: magic, then 32-bit rows, cols, nShips, the nShips
+  // lengths, the 64-bit total and the counts, all in host byte order
+const char OCC_MAGIC[8] = { 'B', 'S', 'O', 'C', 'C', 'U', 'P', 'Y' };
+
+template <typename T>
+void put(ostream& out, T v)
+{
+    out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+bool get(istream& in, T& v)
+{
+    return bool(in.read(reinterpret_cast<char*>(&v), sizeof(v)));
+}
+
+OccupancyTable loaded;
+bool haveLoaded = false;
+uint64_t loadedFingerprint = 0;
+
+}  // namespace
+
+bool writeOccupancy(const string& path, const OccupancyTable& table)
+{
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp, ios::binary);
+        if (!out)
+            return false;
+        out.write(OCC_MAGIC, sizeof(OCC_MAGIC));
+        put<int32_t>(out, table.rows);
+        put<int32_t>(out, table.cols);
+        put<int32_t>(out, int32_t(table.lengths.size()));
+        for (int len : table.lengths)
+            put<int32_t>(out, len);
+        put<uint64_t>(out, table.total);
+        out.write(reinterpret_cast<const char*>(table.counts.data()),
+                  table.counts.size() * sizeof(uint64_t));
+        if (!out.flush())
+        {
+            out.close();
+            remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readOccupancy(const string& path, OccupancyTable& table, string& error)
+{
+    ifstream in(path, ios::binary);
+    if (!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    char magic[8];
+    int32_t rows, cols, nShips;
+    if (!in.read(magic, sizeof(magic))  ||  memcmp(magic, OCC_MAGIC, sizeof(magic)) != 0  ||
+        !get(in, rows)  ||  !get(in, cols)  ||  !get(in, nShips)  ||
+        rows < 1  ||  cols < 1  ||  rows * cols > 4096  ||  nShips < 0  ||  nShips > 64)
+    {
+        error = path + " is not an occupancy table";
+        return false;
+    }
+    table.rows = rows;
+    table.cols = cols;
+    table.lengths.assign(nShips, 0);
+    for (int k = 0; k < nShips; k++)
+    {
+        int32_t len;
+        if (!get(in, len))
+        {
+            error = path + " is truncated";
+            return false;
+        }
+        table.lengths[k] = len;
+    }
+    table.counts.assign(size_t(nShips) * rows * cols, 0);
+    if (!get(in, table.total)  ||
+        !in.read(reinterpret_cast<char*>(table.counts.data()),
+                 table.counts.size() * sizeof(uint64_t)))
+    {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
+
+void loadOccupancyFromEnv()
+{
+    const char* path = getenv("BATTLESHIP_OCCUPANCY");
+    if (path == nullptr  ||  *path == '\0')
+        return;
+    string error;
+    haveLoaded = readOccupancy(path, loaded, error);
+    if (!haveLoaded)
+    {
+        cerr << "Cannot load occupancy table: " << error << endl;
+        return;
+    }
+    int32_t dims[2] = { loaded.rows, loaded.cols };
+    uint64_t h = fingerprint(dims, sizeof(dims));
+    h = fingerprint(loaded.lengths.data(), loaded.lengths.size() * sizeof(int), h);
+    h = fingerprint(&loaded.total, sizeof(loaded.total), h);
+    loadedFingerprint = fingerprint(loaded.counts.data(),
+                                    loaded.counts.size() * sizeof(uint64_t), h);
+}
+
+const OccupancyTable* occupancyFor(const Game& g)
+{
+    return haveLoaded  &&  loaded.matches(g) ? &loaded : nullptr;
+}
+
+uint64_t occupancyFingerprint(const Game& g)
+{
+    return occupancyFor(g) != nullptr ? loadedFingerprint : 0;
+}
+
+//*********************************************************************
+//  occupancy command
+//*********************************************************************
+
+int occupancyMain(int argc, char* argv[])
+{
+    string outPath;
+    int rows = 10;
+    int cols = 10;
+    int nThreads = 0;
+    bool useSymmetry = true;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--no-symmetry")
+        {
+            useSymmetry = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for " << arg << endl;
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--out")
+            outPath = value;
+        else if (arg == "--rows")
+            rows = atoi(value.c_str());
+        else if (arg == "--cols")
+            cols = atoi(value.c_str());
+        else if (arg == "--threads")
+            nThreads = atoi(value.c_str());
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            cerr << "usage: occupancy [--out FILE] [--rows R] [--cols C]"
+                 << " [--threads N] [--no-symmetry]" << endl;
+            return 2;
+        }
+    }
+
+      // The standard fleet, as the players see it
+    vector<int> lengths;
+    if (rows >= 1  &&  rows <= MAXROWS  &&  cols >= 1  &&  cols <= MAXCOLS)
+    {
+        Game g(rows, cols);
+        if (addStandardShips(g))
+            for (int k = 0; k < g.nShips(); k++)
+                lengths.push_back(g.shipLength(k));
+    }
+    if (lengths.empty())
+    {
+        cerr << "The standard fleet does not fit on a " << rows << " x " << cols
+             << " board" << endl;
+        return 2;
+    }
+
+    OccupancyTable table;
+    string error;
+    auto start = chrono::steady_clock::now();
+    if (!enumerateLayouts(rows, cols, lengths, nThreads, useSymmetry, table, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << table.total << " legal layouts (" << seconds << " s)" << endl;
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < cols; c++)
+            cout << (c == 0 ? "" : " ")
+                 << (table.total == 0 ? 0 : int(1000.0 * table.cellCount(r, c) / table.total + 0.5));
+        cout << endl;
+    }
+    if (!outPath.empty()  &&  !writeOccupancy(outPath, table))
+    {
+        cerr << "Cannot write " << outPath << endl;
+        return 1;
+    }
+    return 0;
+}
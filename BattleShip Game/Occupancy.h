@@ -0,0 +1,60 @@
+#ifndef OCCUPANCY_INCLUDED
+#define OCCUPANCY_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Game;
+
+// Exact cell-occupancy tables.  For a board and fleet, the table counts
+// every legal layout (ships inside the board, not overlapping, ships of
+// equal length told apart by id) and, for each ship and cell, how many of
+// those layouts put that ship on that cell.  The counts never change, so
+// they are computed once by enumerateLayouts and saved for the AI players
+// to load at startup.
+
+struct OccupancyTable
+{
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> lengths;           // the fleet, by ship id
+    std::uint64_t total = 0;            // number of legal layouts
+    std::vector<std::uint64_t> counts;  // [shipId * rows * cols + r * cols + c]
+
+    std::uint64_t shipCount(int shipId, int r, int c) const
+    {
+        return counts[(std::size_t(shipId) * rows + r) * cols + c];
+    }
+      // Layouts that put any ship on (r, c)
+    std::uint64_t cellCount(int r, int c) const;
+    bool matches(const Game& g) const;
+};
+
+  // Count the legal layouts of lengths on a rows x cols board, splitting
+  // the search between nThreads threads (0 means one per hardware thread).
+  // Unless useSymmetry is false, only one placement of ship 0 per orbit of
+  // the board's symmetries is searched.  Fails if the board has more than
+  // 128 cells counting one padding column.
+bool enumerateLayouts(int rows, int cols, const std::vector<int>& lengths,
+                      int nThreads, bool useSymmetry, OccupancyTable& table,
+                      std::string& error);
+
+bool writeOccupancy(const std::string& path, const OccupancyTable& table);
+bool readOccupancy(const std::string& path, OccupancyTable& table, std::string& error);
+
+  // Load the table named by the BATTLESHIP_OCCUPANCY environment variable,
+  // if any.  Call at startup, before any games run.
+void loadOccupancyFromEnv();
+
+  // The loaded table, if it describes g's board and fleet
+const OccupancyTable* occupancyFor(const Game& g);
+
+  // A hash of the table occupancyFor(g) returns, or 0 if it returns none.
+  // Results files record it, since the table changes how players aim.
+std::uint64_t occupancyFingerprint(const Game& g);
+
+  // Entry point for "battleship occupancy [options]"
+int occupancyMain(int argc, char* argv[]);
+
+#endif // OCCUPANCY_INCLUDED
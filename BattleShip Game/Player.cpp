@@ -2,13 +2,48 @@
 #include "Board.h"
 #include "Game.h"
 #include "globals.h"
+#include "Stats.h"
+#include "Plugins.h"
+#include "Occupancy.h"
+#include "Heatmap.h"
+#include "Tuning.h"
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
 #include <vector>
-#include <stack>
 
 using namespace std;
 
+//*********************************************************************
+//  Player
+//*********************************************************************
+
+vector<Point> Player::recommendAttacks(int k)
+{
+    vector<Point> shots;
+    for (int n = 0; n < k; n++)
+    {
+          // A player that keeps proposing points already in the salvo gets
+          // its way after a few tries; the repeat is then a wasted shot
+        Point p;
+        for (int tries = 0; tries < 100; tries++)
+        {
+            p = recommendAttack();
+            bool repeat = false;
+            for (const Point& q : shots)
+                if (q.r == p.r  &&  q.c == p.c)
+                    repeat = true;
+            if (!repeat)
+                break;
+        }
+        shots.push_back(p);
+    }
+    return shots;
+}
+
 //*********************************************************************
 //  AwfulPlayer
 //*********************************************************************
@@ -140,7 +175,7 @@ void HumanPlayer::recordAttackByOpponent(Point p){}
 
 class MediocrePlayer : public Player{
 public:
-    MediocrePlayer(string nm, const Game& g);
+    MediocrePlayer(string nm, const Game& g, const MediocreParams& params);
     virtual ~MediocrePlayer();
     virtual bool isHuman() const { return false; }
     virtual bool placeShips(Board& b);
@@ -150,37 +185,45 @@ public:
     bool placeAShip(Board& b, int shipId);
     
 private:
+    bool alreadyAttacked(int r, int c) const;
+    void enumerateCross(Point p);
     Point prePt;
     bool preHit;
     bool preDes;
     bool preValid;
     int preID;
-    vector<Point> preAtt;
     Point shotMadeStateOne;
+    vector<Point> crossTargets;  //untried cells near shotMadeStateOne, in no particular order
     int attState;
+    MediocreParams m_params;
     
 };
 
-MediocrePlayer::MediocrePlayer(string nm, const Game& g) : Player(nm,g), prePt(), preHit(false), preDes(false), preID(-1), attState(1){}
+MediocrePlayer::MediocrePlayer(string nm, const Game& g, const MediocreParams& params) : Player(nm,g), prePt(), preHit(false), preDes(false), preID(-1), attState(1), m_params(params){}
 MediocrePlayer ::~MediocrePlayer(){}
 
 bool MediocrePlayer::placeAShip(Board& b, int shipId){
+    STAT_ADD(STAT_PLACE_A_SHIP_CALLS, 1);
+    STAT_MAX(STAT_PLACE_A_SHIP_DEPTH, shipId + 1);
     //base case: if the shipId passed as param is greater than largest shipId, all ships are placed.
     if (shipId > game().nShips()-1) return true;
     
     //otherwise, try to place ship on any position in any coord on the board
-    
+    //only anchors in the legal-anchor masks can take the ship, so skip the rest without calling placeShip
+    CellSet hor = b.legalAnchors(game().shipLength(shipId), HORIZONTAL);
+    CellSet ver = b.legalAnchors(game().shipLength(shipId), VERTICAL);
     for (int i = 0; i < game().rows(); i++){
+        if ((hor.rows[i] | ver.rows[i]) == 0) continue;
         for (int j = 0; j < game().cols(); j++){
             //if a ship could be placed, check if the rest of the ships could also be placed
-            if (b.placeShip(Point(i,j), shipId, HORIZONTAL)) {
+            if (hor.contains(Point(i,j)) && b.placeShip(Point(i,j), shipId, HORIZONTAL)) {
                 if (placeAShip(b, shipId+1)) return true;
                 //if with current placement, the rest of the ships could not be placed, unplace this ship and try a different position using for-loop
                 else b.unplaceShip(Point(i,j), shipId, HORIZONTAL);
             }
             
             //trying vertical placement at (i,j) if horizontally could not be placed
-            if (b.placeShip(Point(i,j), shipId, VERTICAL)) {
+            if (ver.contains(Point(i,j)) && b.placeShip(Point(i,j), shipId, VERTICAL)) {
                 if (placeAShip(b, shipId+1)) return true;
                 else b.unplaceShip(Point(i,j), shipId, VERTICAL);
             }
@@ -191,72 +234,54 @@ bool MediocrePlayer::placeAShip(Board& b, int shipId){
 
 bool MediocrePlayer::placeShips(Board& b){
     b.clear();
-    b.block();
+    b.block(m_params.blockFraction);
     if (placeAShip(b,0)){
         //if returned true, all ships are placed successfully
         b.unblock();
         return true;
     }
-    else  cerr<<"can't place ships"<<endl;
     return false;
 }
 
+bool MediocrePlayer::alreadyAttacked(int r, int c) const
+{
+    assert(opponentView() != nullptr);
+    return opponentView()->shot(Point(r, c));
+}
+
+//list the cells within the cross radius of p along its row and column, once per entry into state 2
+void MediocrePlayer::enumerateCross(Point p)
+{
+    const int reach = m_params.crossRadius;
+    crossTargets.clear();
+    for (int d = -reach; d <= reach; d++){
+        if (d == 0) continue;
+        if (p.r+d >= 0 && p.r+d < game().rows()) crossTargets.push_back(Point(p.r+d, p.c));
+        if (p.c+d >= 0 && p.c+d < game().cols()) crossTargets.push_back(Point(p.r, p.c+d));
+    }
+}
+
 Point MediocrePlayer::recommendAttack(){
     if (attState==1&&preHit==true) attState=2;
     //in any circumstance, if a ship is destroyed, go to state 1
      if (preDes == true) attState = 1;
-    //return random point in state 1
-    if (attState  == 1){
-        int r,c;
-        bool alrAtt = false;
-        do {
-            alrAtt = false;
-            r = randInt(game().rows());
-            c = randInt(game().cols());
-            if (!preAtt.empty()){
-                for (int i = 0; i < preAtt.size(); i++){
-                    if (preAtt.at(i).r == r && preAtt.at(i).c == c){
-                        alrAtt = true;
-                    }
-                }
-            }
-        } while (alrAtt);
-        return Point(r,c);
+    //return a random untried point of the cross around the shot that started state 2;
+    //once the cross is used up, fall back to state 1
+    while (attState == 2 && !crossTargets.empty()){
+        int k = randInt(static_cast<int>(crossTargets.size()));
+        Point p = crossTargets[k];
+        crossTargets[k] = crossTargets.back();
+        crossTargets.pop_back();
+        if (!alreadyAttacked(p.r, p.c)) return p;
     }
-    
-    //return random point in a set of points close to a last made shot
-    else{
-        int len = 5;
-        int sign;
-        int r,c;
-        bool alrAtt = false;
-        do {
-            alrAtt = false;
-            if (randInt(2) == 0) sign = -1;  else sign = 1;
-            if (randInt(2) == 0){
-                r = shotMadeStateOne.r+sign*randInt(len);
-                if (r<0) r = 0;
-                if (r>=game().rows()) r=game().rows()-1;
-                c = shotMadeStateOne.c;
-            }
-            else {
-                r = shotMadeStateOne.r;
-                c = shotMadeStateOne.c+sign*randInt(len);
-                if (c<0) c = 0;
-                if (c>=game().rows()) c=game().rows()-1;
-            }
-            if (!preAtt.empty()){
-                for (int i = 0; i < preAtt.size(); i++){
-                    if (preAtt.at(i).r == r && preAtt.at(i).c == c){
-                        alrAtt = true;
-                    }
-                }
-            }
-        } while (alrAtt);
-        
-        return Point(r,c);
-    }
-    
+    attState = 1;
+    //return random point in state 1
+    int r,c;
+    do {
+        r = randInt(game().rows());
+        c = randInt(game().cols());
+    } while (alreadyAttacked(r, c));
+    return Point(r,c);
 }
 
 //stores attack result into mediocre player's member variables
@@ -266,9 +291,11 @@ void MediocrePlayer::recordAttackResult(Point p, bool validShot, bool shotHit,bo
     preDes =  shipDestroyed;
     preID = shipId;
     preValid = validShot;
-    preAtt.push_back(p);
-    if(attState==1&&shotHit==true){
+    //a sunk ship ends the search around it at once, even if later shots of a salvo are recorded after it
+    if (shipDestroyed) attState = 1;
+    else if(attState==1&&shotHit==true){
         shotMadeStateOne=p;
+        enumerateCross(p);
         attState=2;
     }
 }
@@ -283,71 +310,71 @@ void MediocrePlayer::recordAttackByOpponent(Point p){}
 
 class GoodPlayer : public Player{
 public:
-    GoodPlayer(string nm, const Game& g);
+    GoodPlayer(string nm, const Game& g, const GoodParams& params);
     virtual ~GoodPlayer();
     virtual bool isHuman() const;
     virtual bool placeShips(Board& b);
     virtual Point recommendAttack();
+    virtual vector<Point> recommendAttacks(int k);
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit,bool shipDestroyed, int shipId);
     virtual void recordAttackByOpponent(Point p);
     bool placeAShip(Board& b, int shipId);
-    bool checkValidPt(Point p);
+    bool checkValidPt(Point p) const;
     Point makeAGuess();
     
 private:
-    Point prePt;
-    bool preHit;
-    bool preDes;
-    bool preValid;
-    int preID;
-    int attState;
-    bool shipLiesHor;
-    bool shipLiesVer;
-    Point guessShotMade;
-    vector<Point> preAtt;
-    stack<Point> state2targets;
-    stack<Point> state3targets;
-    stack<Point> state4targets;
-    vector<Point> attackedInState3;
-    stack<Point> state5targets;
-    bool state3top;
-    bool state3bot;
+    bool shot(Point p) const { assert(opponentView() != nullptr); return opponentView()->shot(p) || m_pending.contains(p); }
+    bool missed(Point p) const { assert(opponentView() != nullptr); return opponentView()->misses.contains(p) || m_pending.contains(p); }
+    int minShipLength() const;
+    bool shipFits(int r, int c, int len) const;
+    int freeRun(Point p, int dir) const;
+    bool pickTarget(Point& target) const;
+    //the shots come from the opponent's view: with every hit there on a ship since sunk the
+    //player hunts, otherwise it targets the open hits, those on ships still afloat
+    CellSet m_pending;              //shots chosen for the salvo being picked, treated as misses
+    vector<bool> m_afloat;          //indexed by ship id; false once that ship is sunk
+    GoodParams m_params;
 };
 
-GoodPlayer::GoodPlayer(string nm, const Game& g) : Player(nm,g) {
-    preHit = false;
-    preDes = false;
-    preValid = false;
-    preID = -1;
-    attState = 1;
-    shipLiesHor=false;
-    shipLiesVer=false;
-    state3top = true;
-    state3bot = true;
-    
-}
+namespace {
+
+  // Unit steps in the four directions; d and d^1 point opposite ways, and
+  // directions 0-1 run along a row, 2-3 along a column
+const int DR[4] = { 0, 0, 1, -1 };
+const int DC[4] = { 1, -1, 0, 0 };
+
+}  // namespace
+
+GoodPlayer::GoodPlayer(string nm, const Game& g, const GoodParams& params)
+ : Player(nm,g), m_pending{}, m_afloat(g.nShips(), true), m_params(params)
+{}
 
 GoodPlayer::~GoodPlayer(){}
 
 bool GoodPlayer::isHuman() const {return false;}
 
 bool GoodPlayer::placeAShip(Board& b, int shipId){
+    STAT_ADD(STAT_PLACE_A_SHIP_CALLS, 1);
+    STAT_MAX(STAT_PLACE_A_SHIP_DEPTH, shipId + 1);
     //base case: if the shipId passed as param is greater than largest shipId, all ships are placed.
     if (shipId > game().nShips()-1) return true;
     
     //otherwise, try to place ship on any position in any coord on the board
-    
+    //only anchors in the legal-anchor masks can take the ship, so skip the rest without calling placeShip
+    CellSet hor = b.legalAnchors(game().shipLength(shipId), HORIZONTAL);
+    CellSet ver = b.legalAnchors(game().shipLength(shipId), VERTICAL);
     for (int i = 0; i < game().rows(); i++){
+        if ((hor.rows[i] | ver.rows[i]) == 0) continue;
         for (int j = 0; j < game().cols(); j++){
             //if a ship could be placed, check if the rest of the ships could also be placed
-            if (b.placeShip(Point(i,j), shipId, HORIZONTAL)) {
+            if (hor.contains(Point(i,j)) && b.placeShip(Point(i,j), shipId, HORIZONTAL)) {
                 if (placeAShip(b, shipId+1)) return true;
                 //if with current placement, the rest of the ships could not be placed, unplace this ship and try a different position using for-loop
                 else b.unplaceShip(Point(i,j), shipId, HORIZONTAL);
             }
             
             //trying vertical placement at (i,j) if horizontally could not be placed
-            if (b.placeShip(Point(i,j), shipId, VERTICAL)) {
+            if (ver.contains(Point(i,j)) && b.placeShip(Point(i,j), shipId, VERTICAL)) {
                 if (placeAShip(b, shipId+1)) return true;
                 else b.unplaceShip(Point(i,j), shipId, VERTICAL);
             }
@@ -358,7 +385,7 @@ bool GoodPlayer::placeAShip(Board& b, int shipId){
 
 bool GoodPlayer::placeShips(Board& b){
     b.clear();
-    b.block();
+    b.block(m_params.blockFraction);
     if (placeAShip(b,0)){
         b.unblock();
         return true;
@@ -367,383 +394,392 @@ bool GoodPlayer::placeShips(Board& b){
     return false;
 }
 
-bool GoodPlayer::checkValidPt(Point p){
-    if (p.r>=game().rows()||p.c>=game().rows()||p.r<0||p.c<0){
+bool GoodPlayer::checkValidPt(Point p) const{
+    if (p.r>=game().rows()||p.c>=game().cols()||p.r<0||p.c<0){
         return false;
     }
-    
-    if (!preAtt.empty()){
-        for (int i = 0; i < preAtt.size(); i++){
-            if (p.r == preAtt.at(i).r && p.c == preAtt.at(i).c){
-                return false;
-            }
-        }
-    }
-    
-    return true;
+    return !shot(p);
 }
 
-Point GoodPlayer::makeAGuess(){
-    int minShipLength = -1;
+//the shortest ship not yet sunk, or 0 once the whole fleet is down
+int GoodPlayer::minShipLength() const
+{
+    int minLen = 0;
     for (int i = 0; i < game().nShips(); i++){
-        if (minShipLength < game().shipLength(i)) minShipLength = game().shipLength(i);
+        if (m_afloat[i] && (minLen == 0 || game().shipLength(i) < minLen)) minLen = game().shipLength(i);
     }
-    
+    return minLen;
+}
 
-    if (minShipLength > 1){
-        int r,c;
-        int counter = 0;
-        do{
-            counter ++;
-            if (randInt(2)==0){
-                //if the row is odd, col must be even
-                r = 2*randInt(game().rows()/2)+1;
-                c = 2*randInt(game().cols()/2);
-            }
-            else {
-                //if the row is even, col must be odd
-                r = 2*randInt(game().rows()/2);
-                c = 2*randInt(game().cols()/2)+1;
-            }
-        } while (!checkValidPt(Point(r,c))&& counter < 100000);
-
-        if (counter > 100000){
-            int a,b;
-            do{
-                a = randInt(game().rows());
-                b = randInt(game().cols());
-            } while (!checkValidPt(Point(a,b)));
-            return Point(a,b);
-        }
-        return Point(r,c);
-    }
-    
-    else {
-        int r,c;
-        do{
-            r = randInt(game().rows());
-            c = randInt(game().cols());
-        } while (!checkValidPt(Point(r,c)));
-        return Point(r,c);
+//cells from p (exclusive) in direction dir before the edge or a miss
+int GoodPlayer::freeRun(Point p, int dir) const
+{
+    int n = 0;
+    Point q(p.r + DR[dir], p.c + DC[dir]);
+    while (game().isValid(q) && !missed(q)){
+        n++;
+        q = Point(q.r + DR[dir], q.c + DC[dir]);
     }
+    return n;
 }
 
-Point GoodPlayer::recommendAttack(){
-    if (attState == 1){
-        return makeAGuess();
+//true if a ship of length len could lie across (r,c) without covering a miss
+bool GoodPlayer::shipFits(int r, int c, int len) const
+{
+    Point p(r, c);
+    return freeRun(p, 0) + freeRun(p, 1) + 1 >= len  ||  freeRun(p, 2) + freeRun(p, 3) + 1 >= len;
+}
+
+Point GoodPlayer::makeAGuess(){
+    STAT_ADD(STAT_GUESS_CALLS, 1);
+    //hunt only unshot cells some surviving ship could still cover, and of those only one residue
+    //class of r+c modulo the shortest surviving length: every such ship covers a cell of each class.
+    //The work is done on one bitmask per row (bit j is column j), as Board::legalAnchors does.
+    assert(opponentView() != nullptr);
+    const ShotView& view = *opponentView();
+    int rows = game().rows();
+    int cols = game().cols();
+    int minLen = max(minShipLength(), 1);
+    int spacing = m_params.paritySpacing > 0 ? m_params.paritySpacing : minLen;
+    uint64_t all = (uint64_t(1) << cols) - 1;
+    uint64_t open[MAXROWS];         //cells not missed
+    uint64_t unshot[MAXROWS];
+    for (int i = 0; i < rows; i++){
+        uint64_t missed = view.misses.rows[i] | m_pending.rows[i];
+        open[i] = all & ~missed;
+        unshot[i] = open[i] & ~view.hits.rows[i];
     }
-    
-    else if (attState == 2){
-        //if a guess shot hit and ship not destroyed, recommend every horiz/vert adjacent point
-        while (!state2targets.empty()){
-            if (checkValidPt(state2targets.top())){
-                Point p = state2targets.top();
-                state2targets.pop();
-                return p;
-            }
-            else state2targets.pop();
-        }
-        
-        //return makeAGuess();
+    //a cell can be covered if it lies in a window of minLen open cells, across or down: find the
+    //windows' first cells by ANDing shifted masks, then spread each window back over its cells
+    uint64_t fits[MAXROWS] = {};
+    for (int i = 0; i < rows; i++){
+        uint64_t across = open[i];
+        for (int k = 1; k < minLen && across != 0; k++) across &= open[i] >> k;
+        for (int k = 0; k < minLen; k++) fits[i] |= across << k;
+        if (i + minLen > rows) continue;
+        uint64_t down = open[i];
+        for (int k = 1; k < minLen && down != 0; k++) down &= open[i+k];
+        for (int k = 0; k < minLen; k++) fits[i+k] |= down;
     }
-    
-    else if (attState == 3){
-        if  (!state3targets.empty()) {
-            Point p;
-            bool success = false;
-            do{
-                p = state3targets.top();
-                state3targets.pop();
-                success = checkValidPt(p);
-            } while (!state3targets.empty()&&!success);
-            if (!success) return makeAGuess();
-            return p;
-        }
+    //the columns of each residue class m, so that row i's cells of class k are those of (k - i) mod spacing
+    uint64_t colClass[MAXROWS + MAXCOLS] = {};
+    for (int j = 0; j < cols; j++) colClass[j % spacing] |= uint64_t(1) << j;
+    auto classCells = [&](int i, int k) { return colClass[((k - i) % spacing + spacing) % spacing]; };
+    int perClass[MAXROWS + MAXCOLS] = {};
+    for (int i = 0; i < rows; i++){
+        uint64_t cand = fits[i] & unshot[i];
+        if (cand == 0) continue;
+        for (int k = 0; k < spacing; k++) perClass[k] += popcount(cand & classCells(i, k));
     }
-    
-    else if (attState == 4){
-        if (!state4targets.empty()){
-            Point p = makeAGuess();
-            bool success = false;
-            do {
-                p = state4targets.top();
-                state4targets.pop();
-                success = checkValidPt(p);
-            } while (!state4targets.empty() && !success);
-            if (!success) return makeAGuess();
-            return p;
-        }
-        else {
-            attState = 1;
-            return makeAGuess();
+    //the class with the fewest candidates left needs the fewest shots to cover
+    int best = -1;
+    for (int k = 0; k < spacing; k++){
+        if (perClass[k] > 0 && (best < 0 || perClass[k] < perClass[best])) best = k;
+    }
+    //with no class left, nothing remains that a ship could cover: any unshot cell will do
+    uint64_t cells[MAXROWS];
+    int nCells = 0;
+    for (int i = 0; i < rows; i++){
+        cells[i] = best < 0 ? unshot[i] : fits[i] & unshot[i] & classCells(i, best);
+        nCells += popcount(cells[i]);
+    }
+    if (nCells == 0) return game().randomPoint();
+    STAT_ADD(STAT_GUESS_DRAWS, 1);
+    //draw the n-th candidate in row-major order, or with an exact occupancy table loaded, a
+    //candidate weighted by how many layouts cover it
+    const OccupancyTable* occ = occupancyFor(game());
+    unsigned long long x;
+    if (occ != nullptr){
+        unsigned long long sum = 0;
+        for (int i = 0; i < rows; i++){
+            for (uint64_t bits = cells[i]; bits != 0; bits &= bits - 1) sum += occ->cellCount(i, countr_zero(bits)) + 1;
         }
+        x = uniform_int_distribution<unsigned long long>(0, sum-1)(randomGenerator());
     }
-    
-    else if (attState == 5){
-        if (!state5targets.empty()){
-            Point p = makeAGuess();
-            bool success = false;
-            do {
-                p = state5targets.top();
-                state5targets.pop();
-                success = checkValidPt(p);
-            } while (!state5targets.empty() && !success);
-            if (!success) return makeAGuess();
-            return p;
+    else x = randInt(nCells);
+    for (int i = 0; ; i++){
+        for (uint64_t bits = cells[i]; bits != 0; bits &= bits - 1){
+            int j = countr_zero(bits);
+            unsigned long long w = occ != nullptr ? occ->cellCount(i, j) + 1 : 1;
+            if (x < w) return Point(i, j);
+            x -= w;
         }
-        else attState = 1;
-        return makeAGuess();
     }
-    return makeAGuess();
 }
 
-void GoodPlayer::recordAttackResult(Point p, bool validShot, bool shotHit, bool shipDestroyed, int shipId){
-    //if a ship is destroyed, return to state 1
-    if (shipDestroyed){
-        //if ship destroyed after attacking along line, but more attacks are made than the length of the ship destroyed
-        if (attState == 3){
-            attackedInState3.push_back(p);
-            if (attackedInState3.size()>game().shipLength(shipId)){
-                attState = 5;
-                if (shipLiesVer){
-                    int rMin = 10;
-                    int rMax = -1;
-                    for (int i = 0; i < attackedInState3.size(); i++){
-                        if (rMin>attackedInState3.at(i).r){
-                            rMin = attackedInState3.at(i).r;
-                        }
-                        
-                        if (rMax < attackedInState3.at(i).r){
-                            rMax = attackedInState3.at(i).r;
-                        }
-                    }
-                    state5targets.push(Point(rMin,attackedInState3.front().c+1));
-                    state5targets.push(Point(rMin,attackedInState3.front().c-1));
-                    state5targets.push(Point(rMin-1,attackedInState3.front().c));
-                    
-                    state5targets.push(Point(rMax,attackedInState3.front().c+1));
-                    state5targets.push(Point(rMax,attackedInState3.front().c-1));
-                    state5targets.push(Point(rMax+1,attackedInState3.front().c));
+//choose the next shot at the open hits: extend the longest line of open hits past whichever end
+//is still unshot, or else probe beside an open hit.  Each open hit is looked at once per
+//direction, so the cost is bounded by the number of open hits, never by the shot history.
+bool GoodPlayer::pickTarget(Point& target) const
+{
+    int minLen = minShipLength();
+    assert(opponentView() != nullptr);
+    const ShotView& view = *opponentView();
+    CellSet open;
+    for (int i = 0; i < MAXROWS; i++){
+        open.rows[i] = view.hits.rows[i] & ~view.sunk.rows[i];
+    }
+    int bestScore = -1;
+    for (int i = 0; i < game().rows(); i++){
+        for (uint64_t bits = open.rows[i]; bits != 0; bits &= bits - 1){
+            Point h(i, countr_zero(bits));
+            bool inLine = false;
+            for (int d = 0; d < 4; d++){
+                Point next(h.r + DR[d], h.c + DC[d]);
+                Point prev(h.r - DR[d], h.c - DC[d]);
+                //only the first cell of a line, walking in direction d, starts a walk
+                if (!game().isValid(next) || !open.contains(next)) continue;
+                inLine = true;
+                if (game().isValid(prev) && open.contains(prev)) continue;
+                int len = 1;
+                Point end = next;
+                while (game().isValid(end) && open.contains(end)){
+                    len++;
+                    end = Point(end.r + DR[d], end.c + DC[d]);
                 }
-                
-                if (shipLiesHor){
-                    int cMin = 10;
-                    int cMax = -1;
-                    for (int i = 0; i < attackedInState3.size(); i++){
-                        if (cMin>attackedInState3.at(i).c){
-                            cMin = attackedInState3.at(i).c;
-                        }
-                        
-                        if (cMax < attackedInState3.at(i).c){
-                            cMax = attackedInState3.at(i).c;
-                        }
+                //the cells beyond either end, if a surviving ship could still reach them
+                Point ends[2] = { end, prev };
+                for (const Point& e : ends){
+                    if (len > bestScore && checkValidPt(e) && shipFits(e.r, e.c, minLen)){
+                        bestScore = len;
+                        target = e;
                     }
-                    state5targets.push(Point(attackedInState3.front().r+1,cMin));
-                    state5targets.push(Point(attackedInState3.front().r-1,cMin));
-                    state5targets.push(Point(attackedInState3.front().r,cMin-1));
-                    
-                    state5targets.push(Point(attackedInState3.front().r+1,cMax));
-                    state5targets.push(Point(attackedInState3.front().r-1,cMax));
-                    state5targets.push(Point(attackedInState3.front().r,cMax+1));
                 }
-                
-               
-                
-                state5targets.push(Point(attackedInState3.back().r+1,attackedInState3.back().c));
-                state5targets.push(Point(attackedInState3.back().r-1,attackedInState3.back().c));
-                state5targets.push(Point(attackedInState3.back().r,attackedInState3.back().c+1));
-                state5targets.push(Point(attackedInState3.back().r,attackedInState3.back().c-1));
             }
-            else attState = 1;
+            //probe beside the hit along whichever axis a surviving ship still fits: beside a lone hit
+            //that is the best lead there is, beside a line of hits (adjacent ships lying across the
+            //line) it is the last resort
+            int score = inLine ? 0 : 1;
+            if (score <= bestScore) continue;
+            for (int k = 0; k < 4; k++){
+                int d = m_params.probeOrder[k];
+                Point q(h.r + DR[d], h.c + DC[d]);
+                if (checkValidPt(q) && freeRun(h, d) + freeRun(h, d^1) + 1 >= minLen){
+                    bestScore = score;
+                    target = q;
+                    break;
+                }
+            }
         }
-        else if (attState == 4 || attState == 5){}
-        else attState = 1;
+    }
+    return bestScore >= 0;
+}
+
+Point GoodPlayer::recommendAttack(){
+    Point p;
+    if (pickTarget(p)) return p;
+    return makeAGuess();
+}
 
+//each shot of a salvo is chosen as if the ones before it had been fired and missed,
+//so the salvo spreads along the target line and across the hunt cells
+vector<Point> GoodPlayer::recommendAttacks(int k)
+{
+    vector<Point> shots;
+    for (int n = 0; n < k; n++){
+        Point p = recommendAttack();
+        if (game().isValid(p)) m_pending.insert(p);
+        shots.push_back(p);
     }
-    
-    if (!shipDestroyed && shotHit && attState==1){
-        //if a guess shot hit target, enter attack state 2
-        while(!state2targets.empty()){
-            state2targets.pop();
-        }
-        state2targets.push(Point(p.r,p.c+1));
-        state2targets.push(Point(p.r,p.c-1));
-        state2targets.push(Point(p.r+1,p.c));
-        state2targets.push(Point(p.r-1,p.c));
-        guessShotMade = p;
-        attState = 2;
+    m_pending = CellSet{};
+    return shots;
+}
+
+void GoodPlayer::recordAttackResult(Point /* p */, bool validShot, bool /* shotHit */, bool shipDestroyed, int shipId){
+    //the shot itself is already in the opponent's view
+    if (validShot && shipDestroyed && shipId >= 0 && shipId < game().nShips()){
+        m_afloat[shipId] = false;
     }
-    
-    else if (shotHit && attState==2){
-        //if after initial shot hit, another shot is hit
-        //determine whether second shot lies horizontal or vertical
-        //assume that that is the orientation of ship
-        while (!attackedInState3.empty()){
-            attackedInState3.pop_back();
-        }
-        shipLiesHor = false;
-        shipLiesVer = false;
-        attackedInState3.push_back(guessShotMade);
-        attackedInState3.push_back(p);
-        if (p.r == guessShotMade.r) shipLiesHor = true;
-        else if (p.c == guessShotMade.c) shipLiesVer = true;
-        attState = 3;
-        state3top=true;
-        state3bot=true;
-
-        if (shipLiesHor) {
-            if (p.c>guessShotMade.c){
-                if (checkValidPt(Point(p.r,p.c+1)))
-                    state3targets.push(Point(p.r,p.c+1));
-                else state3bot = false;
-                
-                if (checkValidPt(Point(p.r,guessShotMade.c-1)))
-                    state3targets.push(Point(p.r,guessShotMade.c-1));
-                else state3top = false;
-            }
-            else {
-                if (checkValidPt(Point(p.r,p.c-1)))
-                    state3targets.push(Point(p.r,p.c-1));
-                else state3top = false;
-                
-                if (checkValidPt(Point(p.r,guessShotMade.c+1)))
-                    state3targets.push(Point(p.r,guessShotMade.c+1));
-                else state3bot = false;
-            }
-        }
-        else if (shipLiesVer) {
-            if (p.r>guessShotMade.r){
-                if (checkValidPt(Point(p.r+1,p.c)))
-                state3targets.push(Point(p.r+1,p.c));
-                else state3bot = false;
-                if (checkValidPt(Point(guessShotMade.r-1,p.c)))
-                state3targets.push(Point(guessShotMade.r-1,p.c));
-                else state3top = false;
-            }
-            else {
-                if (checkValidPt(Point(p.r-1,p.c)))
-                    state3targets.push(Point(p.r-1,p.c));
-                else state3top = false;
-                
-                if (checkValidPt(Point(guessShotMade.r+1,p.c)))
-                state3targets.push(Point(guessShotMade.r+1,p.c));
-                else state3bot = false;
-            }
-        }
+}
+
+void GoodPlayer::recordAttackByOpponent(Point p){}
+//*********************************************************************
+//  HeatmapPlayer
+//*********************************************************************
+
+  // Fires at the cell the most placements of the surviving fleet could
+  // cover (see Heatmap.h); around open hits, at the neighbour that the
+  // most placements through the adjacent line of hits could cover
+class HeatmapPlayer : public Player
+{
+  public:
+    HeatmapPlayer(string nm, const Game& g);
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual vector<Point> recommendAttacks(int k);
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+  private:
+    bool available(Point p) const;
+    bool pickTarget(Point& target) const;
+    static vector<int> fleet(const Game& g);
+    Heatmap m_heat;
+    CellSet m_pending;  // shots chosen for the salvo being picked
+};
+
+HeatmapPlayer::HeatmapPlayer(string nm, const Game& g)
+ : Player(nm, g), m_heat(g.rows(), g.cols(), fleet(g)), m_pending{}
+{}
+
+vector<int> HeatmapPlayer::fleet(const Game& g)
+{
+    vector<int> lengths;
+    for (int k = 0; k < g.nShips(); k++)
+        lengths.push_back(g.shipLength(k));
+    return lengths;
+}
+
+bool HeatmapPlayer::placeShips(Board& b)
+{
+      // Each ship at a random legal anchor; a dead end fails this attempt
+      // and the game asks again
+    b.clear();
+    for (int k = 0; k < game().nShips(); k++)
+    {
+        CellSet anchors[2] = { b.legalAnchors(game().shipLength(k), HORIZONTAL),
+                               b.legalAnchors(game().shipLength(k), VERTICAL) };
+        int n = anchors[0].size() + anchors[1].size();
+        if (n == 0)
+            return false;
+        int pick = randInt(n);
+        for (int d = 0; d < 2; d++)
+            for (int r = 0; r < game().rows(); r++)
+                for (uint64_t bits = anchors[d].rows[r]; bits != 0; bits &= bits - 1)
+                    if (pick-- == 0)
+                        b.placeShip(Point(r, countr_zero(bits)), k,
+                                    d == 0 ? HORIZONTAL : VERTICAL);
     }
-    
-    else if (attState == 3 && shotHit && !shipDestroyed){
-        attackedInState3.push_back(p);
-        if (shipLiesHor && p.c>guessShotMade.c){
-            if (checkValidPt(Point (p.r,p.c+1)))
-            {
-                state3targets.push(Point (p.r,p.c+1));
-                state3bot = true;
-            }
-            else state3bot=false;
-        }
-        if (shipLiesHor && p.c<guessShotMade.c){
-            if (checkValidPt(Point (p.r,p.c-1)))
-            {
-                state3targets.push(Point (p.r,p.c-1));
-                state3top = true;
-            }
-            else state3top=false;
-        }
-        if (shipLiesVer && p.r>guessShotMade.r){
-            if (checkValidPt(Point (p.r+1,p.c)))
-            {
-                state3targets.push(Point (p.r+1,p.c));
-                state3bot = true;
-            }
-            else state3bot=false;
-        }
-        if (shipLiesVer && p.r<guessShotMade.r){
-            if (checkValidPt(Point (p.r-1,p.c)))
+    return true;
+}
+
+bool HeatmapPlayer::available(Point p) const
+{
+    assert(opponentView() != nullptr);
+    return game().isValid(p)  &&  !opponentView()->shot(p)  &&  !m_pending.contains(p);
+}
+
+bool HeatmapPlayer::pickTarget(Point& target) const
+{
+    assert(opponentView() != nullptr);
+    const ShotView& view = *opponentView();
+    const int dr[4] = { 0, 0, 1, -1 };
+    const int dc[4] = { 1, -1, 0, 0 };
+    int64_t best = 0;
+    int ties = 0;
+    for (int r = 0; r < game().rows(); r++)
+        for (uint64_t bits = view.hits.rows[r] & ~view.sunk.rows[r]; bits != 0; bits &= bits - 1)
+        {
+            Point h(r, countr_zero(bits));
+            for (int d = 0; d < 4; d++)
             {
-                state3targets.push(Point (p.r-1,p.c));
-                state3top = true;
-            }
-            else state3top = false;
-        }
-        if (!state3top && !state3bot){
-            attState = 4;
-            for (int i =  0; i< attackedInState3.size(); i++){
-                if (shipLiesVer){
-                    state4targets.push(Point(attackedInState3.at(i).r,attackedInState3.at(i).c+1));
-                    state4targets.push(Point(attackedInState3.at(i).r,attackedInState3.at(i).c-1));
+                Point q(h.r + dr[d], h.c + dc[d]);
+                if (!available(q))
+                    continue;
+                  // The line of open hits running on from h away from q
+                Point end = h;
+                int nHits = 1;
+                for (Point e(h.r - dr[d], h.c - dc[d]);
+                        game().isValid(e)  &&  view.hits.contains(e)  &&  !view.sunk.contains(e);
+                        e = Point(e.r - dr[d], e.c - dc[d]))
+                {
+                    end = e;
+                    nHits++;
                 }
-                else{
-                    state4targets.push(Point(attackedInState3.at(i).r+1,attackedInState3.at(i).c));
-                    state4targets.push(Point(attackedInState3.at(i).r-1,attackedInState3.at(i).c));
+                  // Longer lines of hits first, then the most placements;
+                  // a neighbour no placement covers scores nothing
+                int64_t cover = m_heat.coverings(q.r, q.c, end.r, end.c);
+                int64_t score = cover == 0 ? 0 : nHits * (int64_t(1) << 40) + cover;
+                if (score > best)
+                {
+                    best = score;
+                    ties = 1;
+                    target = q;
                 }
+                else if (score == best  &&  score > 0  &&  randInt(++ties) == 0)
+                    target = q;
             }
         }
-    }
-    
-    else if (attState == 3 && !shotHit){
-        if (shipLiesHor && p.c>guessShotMade.c){
-            state3bot = false;
-        }
-        else if (shipLiesHor && p.c<guessShotMade.c){
-            state3top = false;
-        }
-        if (shipLiesVer && p.r>guessShotMade.r){
-            state3bot = false;
-        }
-        else if (shipLiesVer && p.r<guessShotMade.r){
-            state3top = false;
-        }
-        
-        //if every point in the direction has been attacked (bounded by two empty shots) and ship not destroyed, enter state 4, in which we search for ships adjacent to points
-        if (!state3top && !state3bot){
-            attState = 4;
-            for (int i =  0; i< attackedInState3.size(); i++){
-                if (shipLiesHor){
-                    state4targets.push(Point(attackedInState3.at(i).r+1,attackedInState3.at(i).c));
-                    state4targets.push(Point(attackedInState3.at(i).r-1,attackedInState3.at(i).c));
-                }
-                else{
-                    state4targets.push(Point(attackedInState3.at(i).r,attackedInState3.at(i).c+1));
-                    state4targets.push(Point(attackedInState3.at(i).r,attackedInState3.at(i).c-1));
-                }
+    return best > 0;
+}
+
+Point HeatmapPlayer::recommendAttack()
+{
+    Point p;
+    if (pickTarget(p))
+        return p;
+    int64_t best = -1;
+    int ties = 0;
+    for (int r = 0; r < game().rows(); r++)
+        for (int c = 0; c < game().cols(); c++)
+        {
+            if (!available(Point(r, c)))
+                continue;
+            int64_t h = m_heat.heat(r, c);
+            if (h > best)
+            {
+                best = h;
+                ties = 1;
+                p = Point(r, c);
             }
+            else if (h == best  &&  randInt(++ties) == 0)
+                p = Point(r, c);
         }
+    return best >= 0 ? p : game().randomPoint();
+}
+
+vector<Point> HeatmapPlayer::recommendAttacks(int k)
+{
+    vector<Point> shots;
+    for (int n = 0; n < k; n++)
+    {
+        Point p = recommendAttack();
+        if (game().isValid(p))
+            m_pending.insert(p);
+        shots.push_back(p);
     }
-    
-    else if (attState == 4 && shotHit){
-        state4targets.push(Point(p.r,p.c+1));
-        state4targets.push(Point(p.r,p.c-1));
-        state4targets.push(Point(p.r+1,p.c));
-        state4targets.push(Point(p.r-1,p.c));
-    }
-    
-    else if (attState == 5 && shotHit){
-        state5targets.push(Point(p.r,p.c+1));
-        state5targets.push(Point(p.r,p.c-1));
-        state5targets.push(Point(p.r+1,p.c));
-        state5targets.push(Point(p.r-1,p.c));
+    m_pending = CellSet{};
+    return shots;
+}
+
+void HeatmapPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                       bool shipDestroyed, int shipId)
+{
+    if (!validShot  ||  !game().isValid(p))
+        return;
+    if (!shotHit)
+        m_heat.block(p.r, p.c);
+    if (shipDestroyed  &&  shipId >= 0  &&  shipId < game().nShips())
+    {
+          // The sunk ship's cells can hold no other ship
+        assert(opponentView() != nullptr);
+        const ShotView& view = *opponentView();
+        for (int r = 0; r < game().rows(); r++)
+            for (uint64_t bits = view.sunk.rows[r]; bits != 0; bits &= bits - 1)
+                m_heat.block(r, countr_zero(bits));
+        m_heat.sink(game().shipLength(shipId));
     }
-    
-    prePt = p;
-    preHit = shotHit;
-    preDes =  shipDestroyed;
-    preID = shipId;
-    preValid = validShot;
-    preAtt.push_back(p);
 }
 
-void GoodPlayer::recordAttackByOpponent(Point p){}
+void HeatmapPlayer::recordAttackByOpponent(Point /* p */)
+{
+}
+
 //*********************************************************************
 //  createPlayer
 //*********************************************************************
 
+static const string types[] = {
+    "human", "awful", "mediocre", "good", "heatmap"
+};
+
 Player* createPlayer(string type, string nm, const Game& g)
 {
-    static string types[] = {
-        "human", "awful", "mediocre", "good"
-    };
-    
+    return createPlayer(type, nm, g, playerParams());
+}
+
+Player* createPlayer(string type, string nm, const Game& g, const PlayerParams& params)
+{
     int pos;
     for (pos = 0; pos != sizeof(types)/sizeof(types[0])  &&
                                                      type != types[pos]; pos++)
@@ -752,8 +788,17 @@ Player* createPlayer(string type, string nm, const Game& g)
     {
       case 0:  return new HumanPlayer(nm, g);
       case 1:  return new AwfulPlayer(nm, g);
-      case 2:  return new MediocrePlayer(nm, g);
-      case 3:  return new GoodPlayer(nm, g);
-      default: return nullptr;
+      case 2:  return new MediocrePlayer(nm, g, params.mediocre);
+      case 3:  return new GoodPlayer(nm, g, params.good);
+      case 4:  return new HeatmapPlayer(nm, g);
+      default: return createPluginPlayer(type, nm, g);
     }
 }
+
+vector<string> playerTypes()
+{
+    vector<string> result(types, types + sizeof(types)/sizeof(types[0]));
+    for (const string& name : pluginStrategyNames())
+        result.push_back(name);
+    return result;
+}
@@ -2,27 +2,42 @@
 #define PLAYER_INCLUDED
 
 #include <string>
+#include <vector>
 
 class Point;
 class Board;
 class Game;
+struct ShotView;
+struct PlayerParams;
 
 class Player
 {
   public:
     Player(std::string nm, const Game& g)
-     : m_name(nm), m_game(g)
+     : m_name(nm), m_game(g), m_view(nullptr)
     {}
 
     virtual ~Player() {}
 
-    std::string name() const { return m_name; }
+    const std::string& name() const { return m_name; }
     const Game& game() const { return m_game; }
+      // The opponent's board as this player may see it (see Board.h).  It
+      // is set before the first shot, and the built-in players read their
+      // shots from it rather than recording them; code that drives a player
+      // without Game must set it too.  Players that wrap another player
+      // pass it on.
+    virtual void setOpponentView(const ShotView* view) { m_view = view; }
+    const ShotView* opponentView() const { return m_view; }
 
     virtual bool isHuman() const { return false; }
 
     virtual bool placeShips(Board& b) = 0;
     virtual Point recommendAttack() = 0;
+      // The k shots of a salvo, all fired before any result is recorded.
+      // By default this asks recommendAttack k times, passing over points
+      // already chosen for the salvo; players that can choose correlated
+      // shots together should override it.
+    virtual std::vector<Point> recommendAttacks(int k);
     virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
                                         bool shipDestroyed, int shipId) = 0;
     virtual void recordAttackByOpponent(Point p) = 0;
@@ -33,8 +48,18 @@ class Player
   private:
     std::string m_name;
     const Game& m_game;
+    const ShotView* m_view;
 };
 
 Player* createPlayer(std::string type, std::string nm, const Game& g);
 
+  // The same, but with params for the built-in AI players in place of
+  // playerParams() (see Tuning.h)
+Player* createPlayer(std::string type, std::string nm, const Game& g,
+                     const PlayerParams& params);
+
+  // Every type createPlayer accepts: the built-in players, then any
+  // strategies loaded from plugins (see Plugins.h)
+std::vector<std::string> playerTypes();
+
 #endif // PLAYER_INCLUDED
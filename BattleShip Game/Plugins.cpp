@@ -0,0 +1,221 @@
+#include "Plugins.h"
+#include "StrategyPlugin.h"
+#include "Board.h"
+#include "Game.h"
+#include "Player.h"
+#include "globals.h"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+vector<const bs_strategy*> strategies;
+
+int hostRandInt(int limit)
+{
+    return randInt(limit);
+}
+
+void boardClear(void* b)   { static_cast<Board*>(b)->clear(); }
+void boardBlock(void* b)   { static_cast<Board*>(b)->block(); }
+void boardUnblock(void* b) { static_cast<Board*>(b)->unblock(); }
+
+int boardPlace(void* b, int r, int c, int shipId, int vertical)
+{
+    return static_cast<Board*>(b)->placeShip(Point(r, c), shipId,
+                                             vertical ? VERTICAL : HORIZONTAL);
+}
+
+int boardUnplace(void* b, int r, int c, int shipId, int vertical)
+{
+    return static_cast<Board*>(b)->unplaceShip(Point(r, c), shipId,
+                                               vertical ? VERTICAL : HORIZONTAL);
+}
+
+//*********************************************************************
+//  PluginPlayer
+//*********************************************************************
+
+class PluginPlayer : public Player
+{
+  public:
+    PluginPlayer(const bs_strategy* s, string nm, const Game& g);
+    virtual ~PluginPlayer();
+    virtual bool placeShips(Board& b);
+    virtual Point recommendAttack();
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                                bool shipDestroyed, int shipId);
+    virtual void recordAttackByOpponent(Point p);
+      // False if the strategy's create declined the game
+    bool created() const { return m_self != nullptr; }
+  private:
+    const bs_strategy* m_strategy;
+    vector<int> m_lengths;
+    void* m_self;
+};
+
+PluginPlayer::PluginPlayer(const bs_strategy* s, string nm, const Game& g)
+ : Player(nm, g), m_strategy(s)
+{
+    for (int k = 0; k < g.nShips(); k++)
+        m_lengths.push_back(g.shipLength(k));
+    bs_game_info info = { g.rows(), g.cols(), g.nShips(), m_lengths.data(),
+                          hostRandInt };
+    m_self = m_strategy->create(&info);
+}
+
+PluginPlayer::~PluginPlayer()
+{
+    if (m_self != nullptr)
+        m_strategy->destroy(m_self);
+}
+
+bool PluginPlayer::placeShips(Board& b)
+{
+    bs_board_ops ops = { &b, boardClear, boardBlock, boardUnblock,
+                         boardPlace, boardUnplace };
+    return m_strategy->place_ships(m_self, &ops) != 0;
+}
+
+Point PluginPlayer::recommendAttack()
+{
+    int r = -1, c = -1;
+    m_strategy->recommend_attack(m_self, &r, &c);
+    return Point(r, c);
+}
+
+void PluginPlayer::recordAttackResult(Point p, bool validShot, bool shotHit,
+                                      bool shipDestroyed, int shipId)
+{
+    m_strategy->record_attack_result(m_self, p.r, p.c, validShot, shotHit,
+                                     shipDestroyed, shipId);
+}
+
+void PluginPlayer::recordAttackByOpponent(Point p)
+{
+    m_strategy->record_attack_by_opponent(m_self, p.r, p.c);
+}
+
+bool nameTaken(const string& name)
+{
+    for (const string& t : playerTypes())
+        if (t == name)
+            return true;
+    return false;
+}
+
+bool complete(const bs_strategy& s)
+{
+    return s.name != nullptr  &&  s.create != nullptr  &&  s.destroy != nullptr  &&
+           s.place_ships != nullptr  &&  s.recommend_attack != nullptr  &&
+           s.record_attack_result != nullptr  &&  s.record_attack_by_opponent != nullptr;
+}
+
+}  // namespace
+
+int loadStrategyPlugin(const string& path)
+{
+#ifdef _WIN32
+    HMODULE lib = LoadLibraryA(path.c_str());
+    bs_plugin_entry entry = lib == nullptr ? nullptr :
+        reinterpret_cast<bs_plugin_entry>(GetProcAddress(lib, BS_PLUGIN_ENTRY_NAME));
+#else
+    void* lib = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    bs_plugin_entry entry = lib == nullptr ? nullptr :
+        reinterpret_cast<bs_plugin_entry>(dlsym(lib, BS_PLUGIN_ENTRY_NAME));
+#endif
+    if (entry == nullptr)
+    {
+        cerr << "Cannot load strategy plugin " << path << endl;
+        return -1;
+    }
+      // The library stays loaded for the rest of the run
+    int count = 0;
+    const bs_strategy* exported = entry(&count);
+    int registered = 0;
+    for (int i = 0; exported != nullptr  &&  i < count; i++)
+    {
+        const bs_strategy& s = exported[i];
+        if (s.abi_version != BS_STRATEGY_ABI_VERSION)
+        {
+            cerr << path << ": strategy " << i << " has ABI version "
+                 << s.abi_version << ", expected " << BS_STRATEGY_ABI_VERSION
+                 << endl;
+            continue;
+        }
+        if (!complete(s))
+        {
+            cerr << path << ": strategy " << i << " is incomplete" << endl;
+            continue;
+        }
+        if (nameTaken(s.name))
+        {
+            cerr << path << ": player type " << s.name << " already exists" << endl;
+            continue;
+        }
+        strategies.push_back(&s);
+        registered++;
+    }
+    return registered;
+}
+
+int loadStrategyPluginsFromEnv()
+{
+    const char* list = getenv("BATTLESHIP_PLUGINS");
+    if (list == nullptr)
+        return 0;
+#ifdef _WIN32
+    const char sep = ';';
+#else
+    const char sep = ':';
+#endif
+    int total = 0;
+    string paths = list;
+    size_t start = 0;
+    while (start <= paths.size())
+    {
+        size_t end = paths.find(sep, start);
+        if (end == string::npos)
+            end = paths.size();
+        if (end > start)
+        {
+            int n = loadStrategyPlugin(paths.substr(start, end - start));
+            if (n > 0)
+                total += n;
+        }
+        start = end + 1;
+    }
+    return total;
+}
+
+vector<string> pluginStrategyNames()
+{
+    vector<string> names;
+    for (const bs_strategy* s : strategies)
+        names.push_back(s->name);
+    return names;
+}
+
+Player* createPluginPlayer(const string& type, const string& nm, const Game& g)
+{
+    for (const bs_strategy* s : strategies)
+        if (type == s->name)
+        {
+            PluginPlayer* p = new PluginPlayer(s, nm, g);
+            if (!p->created())
+            {
+                delete p;
+                return nullptr;
+            }
+            return p;
+        }
+    return nullptr;
+}
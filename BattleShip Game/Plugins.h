@@ -0,0 +1,29 @@
+#ifndef PLUGINS_INCLUDED
+#define PLUGINS_INCLUDED
+
+#include <string>
+#include <vector>
+
+class Game;
+class Player;
+
+  // Load the strategies exported by the shared object at path (see
+  // StrategyPlugin.h).  Returns how many were registered, or -1 if the
+  // object could not be loaded.  Not thread-safe: load plugins at startup,
+  // before any games run.
+int loadStrategyPlugin(const std::string& path);
+
+  // Load every plugin listed in the BATTLESHIP_PLUGINS environment variable
+  // (separated by ':', or ';' on Windows).  Returns the number of strategies
+  // registered.
+int loadStrategyPluginsFromEnv();
+
+  // Names of the strategies registered by plugins, in load order
+std::vector<std::string> pluginStrategyNames();
+
+  // A player backed by the plugin strategy called type, or nullptr if there
+  // is none or its create function returned NULL
+Player* createPluginPlayer(const std::string& type, const std::string& nm,
+                           const Game& g);
+
+#endif // PLUGINS_INCLUDED
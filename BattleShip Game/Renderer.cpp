@@ -0,0 +1,159 @@
+#include "Renderer.h"
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+Renderer::Mode consoleMode()
+{
+    const char* forced = getenv("BATTLESHIP_RENDER");
+    if (forced != nullptr  &&  strcmp(forced, "plain") == 0)
+        return Renderer::PLAIN;
+    if (forced != nullptr  &&  strcmp(forced, "terminal") == 0)
+        return Renderer::TERMINAL;
+#ifdef _WIN32
+    return Renderer::PLAIN;     // VT sequences need explicit opt-in there
+#else
+    const char* term = getenv("TERM");
+    if (!isatty(STDOUT_FILENO)  ||  term == nullptr  ||  strcmp(term, "dumb") == 0)
+        return Renderer::PLAIN;
+    return Renderer::TERMINAL;
+#endif
+}
+
+}  // namespace
+
+Renderer::Renderer(ostream& out, Mode mode)
+ : m_out(out), m_mode(mode), m_width(0), m_height(0),
+   m_shownWidth(0), m_shownHeight(0), m_onScreen(false)
+{}
+
+Renderer::~Renderer()
+{
+    if (m_mode == TERMINAL  &&  m_onScreen)
+    {
+          // Give the whole screen back to ordinary output
+        m_buf = "\x1b[r";
+        moveTo(999, 1);
+        m_out.write(m_buf.data(), m_buf.size());
+        m_out.flush();
+    }
+}
+
+Renderer& Renderer::console()
+{
+    static Renderer renderer(cout, consoleMode());
+    return renderer;
+}
+
+void Renderer::setMode(Mode mode)
+{
+    m_mode = mode;
+    invalidate();
+}
+
+char* Renderer::beginFrame(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_back.assign(static_cast<size_t>(width) * height, ' ');
+    return &m_back[0];
+}
+
+void Renderer::endFrame()
+{
+    m_buf.clear();
+    if (m_mode == PLAIN)
+        emitPlain();
+    else if (!m_onScreen  ||  m_width != m_shownWidth  ||  m_height != m_shownHeight)
+        emitFull();
+    else
+        emitDiff();
+    if (!m_buf.empty())
+        m_out.write(m_buf.data(), m_buf.size());
+    if (m_mode == TERMINAL)
+    {
+        m_front.swap(m_back);
+        m_shownWidth = m_width;
+        m_shownHeight = m_height;
+        m_onScreen = true;
+    }
+}
+
+void Renderer::invalidate()
+{
+    m_onScreen = false;
+}
+
+void Renderer::emitPlain()
+{
+    m_buf.reserve(m_back.size() + m_height);
+    for (int r = 0; r < m_height; r++)
+    {
+        m_buf.append(m_back, static_cast<size_t>(r) * m_width, m_width);
+        m_buf += '\n';
+    }
+}
+
+  // Clear the screen, pin the frame to the top rows and let everything
+  // else scroll in the rows below it.
+void Renderer::emitFull()
+{
+    m_buf += "\x1b[r\x1b[2J";
+    m_buf += "\x1b[" + to_string(m_height + 2) + "r";
+    for (int r = 0; r < m_height; r++)
+    {
+        moveTo(r + 1, 1);
+        m_buf.append(m_back, static_cast<size_t>(r) * m_width, m_width);
+    }
+    moveTo(999, 1);
+}
+
+void Renderer::emitDiff()
+{
+    size_t start = m_buf.size();
+    m_buf += "\x1b" "7";        // save the cursor in the scrolling region
+    size_t afterSave = m_buf.size();
+    for (int r = 0; r < m_height; r++)
+    {
+        const char* now = m_back.data() + static_cast<size_t>(r) * m_width;
+        const char* shown = m_front.data() + static_cast<size_t>(r) * m_width;
+        int c = 0;
+        while (c < m_width)
+        {
+            if (now[c] == shown[c])
+            {
+                c++;
+                continue;
+            }
+            int runEnd = c + 1;
+            while (runEnd < m_width  &&  now[runEnd] != shown[runEnd])
+                runEnd++;
+            moveTo(r + 1, c + 1);
+            m_buf.append(now + c, runEnd - c);
+            c = runEnd;
+        }
+    }
+    if (m_buf.size() == afterSave)
+        m_buf.resize(start);    // nothing changed; write nothing
+    else
+        m_buf += "\x1b" "8";
+}
+
+void Renderer::moveTo(int row, int col)
+{
+    m_buf += "\x1b[";
+    m_buf += to_string(row);
+    m_buf += ';';
+    m_buf += to_string(col);
+    m_buf += 'H';
+}
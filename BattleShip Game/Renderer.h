@@ -0,0 +1,56 @@
+#ifndef RENDERER_INCLUDED
+#define RENDERER_INCLUDED
+
+#include <iosfwd>
+#include <string>
+
+// Composes a whole frame of text into a buffer and emits it with a single
+// write.  In PLAIN mode each frame is written out in full.  In TERMINAL
+// mode the frame stays pinned to the top of the screen, only the cells that
+// differ from the frame already on screen are rewritten (using ANSI cursor
+// moves), and other output scrolls in the region below it.
+
+class Renderer
+{
+  public:
+    enum Mode { PLAIN, TERMINAL };
+
+    Renderer(std::ostream& out, Mode mode);
+    ~Renderer();
+
+      // The renderer for cout.  It uses TERMINAL mode when cout is a
+      // terminal, unless BATTLESHIP_RENDER is set to "plain" (or "terminal"
+      // to force it).
+    static Renderer& console();
+
+    Mode mode() const { return m_mode; }
+    void setMode(Mode mode);
+
+      // Return a width*height buffer of blanks for the next frame; fill it
+      // in row-major order, then call endFrame to show it.
+    char* beginFrame(int width, int height);
+    void endFrame();
+
+      // Forget what is on screen, so the next frame is drawn in full
+    void invalidate();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+  private:
+    void emitPlain();
+    void emitFull();
+    void emitDiff();
+    void moveTo(int row, int col);
+
+    std::ostream& m_out;
+    Mode m_mode;
+    std::string m_back;         // frame being composed
+    std::string m_front;        // frame on screen (TERMINAL mode)
+    int m_width, m_height;
+    int m_shownWidth, m_shownHeight;
+    bool m_onScreen;            // m_front reflects the screen
+    std::string m_buf;          // bytes for the single write
+};
+
+#endif // RENDERER_INCLUDED
@@ -0,0 +1,330 @@
+#include "Results.h"
+#include "Game.h"
+#include "Occupancy.h"
+#include "Tuning.h"
+#include "globals.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+const char* const MAGIC = "battleship-results";
+const int VERSION = 1;
+
+void writeHistogram(ostream& out, const char* key, const vector<long long>& h)
+{
+    out << key << " " << h.size();
+    for (long long n : h)
+        out << " " << n;
+    out << "\n";
+}
+
+bool readHistogram(istream& in, vector<long long>& h)
+{
+    size_t n;
+    if (!(in >> n)  ||  n > 1000000)
+        return false;
+    h.assign(n, 0);
+    for (size_t s = 0; s < n; s++)
+        if (!(in >> h[s]))
+            return false;
+    return true;
+}
+
+  // Coalesce adjacent runs; returns false if any two overlap
+bool normalizeRanges(vector<pair<long long, long long>>& ranges)
+{
+    sort(ranges.begin(), ranges.end());
+    vector<pair<long long, long long>> merged;
+    for (const pair<long long, long long>& r : ranges)
+    {
+        if (r.first >= r.second)
+            continue;
+        if (!merged.empty()  &&  r.first < merged.back().second)
+            return false;
+        if (!merged.empty()  &&  r.first == merged.back().second)
+            merged.back().second = r.second;
+        else
+            merged.push_back(r);
+    }
+    ranges = merged;
+    return true;
+}
+
+double mean(const vector<long long>& h, long long n)
+{
+    long long total = 0;
+    for (size_t s = 0; s < h.size(); s++)
+        total += h[s] * s;
+    return n == 0 ? 0 : double(total) / n;
+}
+
+}  // namespace
+
+SeriesResults seriesResults(const TournamentConfig& config, long long first,
+                            long long end, const TournamentResult& r)
+{
+    SeriesResults s;
+    s.type1 = config.type1;
+    s.type2 = config.type2;
+    s.rows = config.rows;
+    s.cols = config.cols;
+    s.shotsPerTurn = config.shotsPerTurn;
+    s.seed = config.seed;
+    s.pipelinedLayouts = config.layoutWorkers > 0;
+    Game g(config.rows, config.cols);
+    addStandardShips(g);
+    uint64_t loaded[2] = { occupancyFingerprint(g), playerParamsFingerprint() };
+    if (loaded[0] != 0  ||  loaded[1] != 0)
+        s.fingerprint = fingerprint(loaded, sizeof(loaded));
+    if (first < end)
+        s.ranges.push_back(make_pair(first, end));
+    s.result = r;
+    statsSnapshot(s.stats);
+    return s;
+}
+
+bool writeResults(const string& path, const SeriesResults& s)
+{
+      // Write to a temporary name so a killed process never leaves a
+      // truncated file that looks complete
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp);
+        if (!out)
+            return false;
+        out << MAGIC << " " << VERSION << "\n"
+            << "p1 " << s.type1 << "\n"
+            << "p2 " << s.type2 << "\n"
+            << "board " << s.rows << " " << s.cols << "\n"
+            << "seed " << s.seed << "\n";
+        if (s.shotsPerTurn != 1)
+            out << "salvo " << s.shotsPerTurn << "\n";
+        if (s.pipelinedLayouts)
+            out << "layouts pipeline\n";
+        if (s.fingerprint != 0)
+            out << "fingerprint " << hex << s.fingerprint << dec << "\n";
+        for (const pair<long long, long long>& r : s.ranges)
+            out << "range " << r.first << " " << r.second << "\n";
+        out << "games " << s.result.games << " " << s.result.wins1 << " "
+            << s.result.wins2 << " " << s.result.unfinished << "\n";
+        writeHistogram(out, "shots1", s.result.shots1);
+        writeHistogram(out, "shots2", s.result.shots2);
+        for (int k = 0; k < NSTATS; k++)
+            out << "stat " << statName(StatCounter(k)) << " " << s.stats[k] << "\n";
+        out << "end\n";
+        if (!out.flush())
+        {
+            out.close();
+            remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readResults(const string& path, SeriesResults& s, string& error)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    string magic;
+    int version;
+    if (!(in >> magic >> version)  ||  magic != MAGIC)
+    {
+        error = path + " is not a results file";
+        return false;
+    }
+    if (version != VERSION)
+    {
+        error = path + " has unsupported version " + to_string(version);
+        return false;
+    }
+
+    s = SeriesResults();
+    bool ended = false;
+    string key;
+    while (!ended  &&  in >> key)
+    {
+        bool ok = true;
+        if (key == "p1")
+            ok = bool(in >> s.type1);
+        else if (key == "p2")
+            ok = bool(in >> s.type2);
+        else if (key == "board")
+            ok = bool(in >> s.rows >> s.cols);
+        else if (key == "seed")
+            ok = bool(in >> s.seed);
+        else if (key == "salvo")
+            ok = bool(in >> s.shotsPerTurn);
+        else if (key == "layouts")
+        {
+            string mode;
+            ok = (in >> mode)  &&  mode == "pipeline";
+            s.pipelinedLayouts = ok;
+        }
+        else if (key == "fingerprint")
+            ok = bool(in >> hex >> s.fingerprint >> dec);
+        else if (key == "range")
+        {
+            pair<long long, long long> r;
+            ok = bool(in >> r.first >> r.second);
+            s.ranges.push_back(r);
+        }
+        else if (key == "games")
+            ok = bool(in >> s.result.games >> s.result.wins1
+                         >> s.result.wins2 >> s.result.unfinished);
+        else if (key == "shots1")
+            ok = readHistogram(in, s.result.shots1);
+        else if (key == "shots2")
+            ok = readHistogram(in, s.result.shots2);
+        else if (key == "stat")
+        {
+              // Counters this build does not know are skipped
+            string name;
+            long long v;
+            ok = bool(in >> name >> v);
+            for (int k = 0; k < NSTATS; k++)
+                if (name == statName(StatCounter(k)))
+                    s.stats[k] = v;
+        }
+        else if (key == "end")
+            ended = true;
+        else
+        {
+            error = path + ": unknown key " + key;
+            return false;
+        }
+        if (!ok)
+        {
+            error = path + ": malformed " + key + " line";
+            return false;
+        }
+    }
+    if (!ended)
+    {
+        error = path + " is truncated";
+        return false;
+    }
+    if (!normalizeRanges(s.ranges))
+    {
+        error = path + " lists overlapping game ranges";
+        return false;
+    }
+    return true;
+}
+
+bool mergeResults(SeriesResults& into, const SeriesResults& from, string& error)
+{
+    if (into.type1 != from.type1  ||  into.type2 != from.type2  ||
+        into.rows != from.rows  ||  into.cols != from.cols  ||
+        into.shotsPerTurn != from.shotsPerTurn  ||  into.seed != from.seed)
+    {
+        error = "results belong to different series";
+        return false;
+    }
+    if (into.pipelinedLayouts != from.pipelinedLayouts)
+    {
+        error = "results differ in whether fleets were placed ahead of play";
+        return false;
+    }
+    if (into.fingerprint != from.fingerprint)
+    {
+        error = "results were played with different occupancy tables or player parameters";
+        return false;
+    }
+    vector<pair<long long, long long>> ranges = into.ranges;
+    ranges.insert(ranges.end(), from.ranges.begin(), from.ranges.end());
+    if (!normalizeRanges(ranges))
+    {
+        error = "results share games";
+        return false;
+    }
+    into.ranges = ranges;
+    addResult(into.result, from.result);
+    mergeStats(into.stats, from.stats);
+    return true;
+}
+
+void mergeStats(long long into[NSTATS], const long long from[NSTATS])
+{
+    for (int k = 0; k < NSTATS; k++)
+    {
+        if (statIsMax(StatCounter(k)))
+            into[k] = max(into[k], from[k]);
+        else
+            into[k] += from[k];
+    }
+}
+
+int mergeMain(int argc, char* argv[])
+{
+    string outPath;
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0  &&  i + 1 < argc)
+            outPath = argv[++i];
+        else
+            inputs.push_back(argv[i]);
+    }
+    if (inputs.empty())
+    {
+        cerr << "usage: merge [--out FILE] FILE..." << endl;
+        return 2;
+    }
+
+    SeriesResults total;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        SeriesResults s;
+        string error;
+        if (!readResults(inputs[i], s, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        if (i == 0)
+            total = s;
+        else if (!mergeResults(total, s, error))
+        {
+            cerr << inputs[i] << ": " << error << endl;
+            return 1;
+        }
+    }
+
+    const TournamentResult& r = total.result;
+    cout << total.type1 << " (1) won " << r.wins1 << ", " << total.type2
+         << " (2) won " << r.wins2 << " out of " << r.games << " games";
+    if (r.unfinished > 0)
+        cout << " (" << r.unfinished << " unfinished)";
+    cout << "." << endl;
+    cout << "Mean shots to win: " << total.type1 << " " << mean(r.shots1, r.wins1)
+         << ", " << total.type2 << " " << mean(r.shots2, r.wins2) << endl;
+    cout << "Games covered:";
+    for (const pair<long long, long long>& g : total.ranges)
+        cout << " [" << g.first << ", " << g.second << ")";
+    cout << endl;
+
+    if (!outPath.empty()  &&  !writeResults(outPath, total))
+    {
+        cerr << "Cannot write " << outPath << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef RESULTS_INCLUDED
+#define RESULTS_INCLUDED
+
+#include "Stats.h"
+#include "Tournament.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Mergeable results files.  A file holds the outcome of some set of games
+// of one series -- the series being fixed by the player types, board size,
+// shots per turn, seed, how fleets are placed and what the players loaded
+// at startup -- so that shards played by separate processes can be added
+// up into exact totals.  The format is line-oriented text:
+//
+//     battleship-results 1
+//     p1 good
+//     p2 mediocre
+//     board 10 10
+//     seed 1
+//     salvo 0                  shots per turn, if not 1 (see Game.h)
+//     layouts pipeline         if fleets were placed ahead of play
+//     fingerprint 9c2e...      hash of the occupancy table (see
+//                              Occupancy.h) and player parameters (see
+//                              Tuning.h) the players used, if not the
+//                              defaults
+//     range 0 500              one line per half-open run of games
+//     games 500 1 2 0          games, wins1, wins2, unfinished
+//     shots1 45 0 ... 3        length, then games won with 0, 1, ... shots
+//     shots2 52 0 ... 1
+//     stat games 1000          engine counters (see Stats.h), by name
+//     end
+
+struct SeriesResults
+{
+    std::string type1;
+    std::string type2;
+    int rows = 10;
+    int cols = 10;
+    int shotsPerTurn = 1;
+    unsigned long long seed = 1;
+    bool pipelinedLayouts = false;  // see TournamentConfig::layoutWorkers
+    unsigned long long fingerprint = 0;    // 0 if the players loaded nothing
+    std::vector<std::pair<long long, long long>> ranges;   // sorted, disjoint
+    TournamentResult result;
+    long long stats[NSTATS] = {};
+};
+
+  // Describe config's series, played over games [first, end)
+SeriesResults seriesResults(const TournamentConfig& config, long long first,
+                            long long end, const TournamentResult& r);
+
+bool writeResults(const std::string& path, const SeriesResults& s);
+
+  // On failure, error says why
+bool readResults(const std::string& path, SeriesResults& s, std::string& error);
+
+  // Add from into into.  Fails, leaving into unchanged, if the two belong
+  // to different series or share any game.
+bool mergeResults(SeriesResults& into, const SeriesResults& from, std::string& error);
+
+  // Add the counters in from to into, taking the larger of max counters
+void mergeStats(long long into[NSTATS], const long long from[NSTATS]);
+
+  // Entry point for "battleship merge [--out FILE] FILE..."
+int mergeMain(int argc, char* argv[]);
+
+#endif // RESULTS_INCLUDED
@@ -0,0 +1,143 @@
+#include "Stats.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct StatInfo
+{
+    const char* name;
+    bool isMax;
+};
+
+const StatInfo statInfo[NSTATS] = {
+    { "games", false },
+    { "placement.attempts", false },
+    { "placement.failures", false },
+    { "block.draws", false },
+    { "block.rejections", false },
+    { "placeAShip.calls", false },
+    { "placeAShip.maxDepth", true },
+    { "makeAGuess.calls", false },
+    { "makeAGuess.draws", false },
+    { "shots", false },
+    { "shots.wasted", false },
+    { "time.placement_ns", false },
+    { "time.game_ns", false },
+    { "layout.waits", false },
+};
+
+  // Blocks are never freed, so counts from finished threads survive until
+  // the report is written.
+mutex registryMutex;
+vector<unique_ptr<StatBlock>> registry;
+
+}  // namespace
+
+StatBlock* registerThreadStats()
+{
+    unique_ptr<StatBlock> block(new StatBlock);
+    for (int s = 0; s < NSTATS; s++)
+        block->value[s].store(0, memory_order_relaxed);
+    lock_guard<mutex> lock(registryMutex);
+    registry.push_back(move(block));
+    return registry.back().get();
+}
+
+void statsSnapshot(long long totals[NSTATS])
+{
+    for (int s = 0; s < NSTATS; s++)
+        totals[s] = 0;
+    lock_guard<mutex> lock(registryMutex);
+    for (const unique_ptr<StatBlock>& block : registry)
+        for (int s = 0; s < NSTATS; s++)
+        {
+            long long v = block->value[s].load(memory_order_relaxed);
+            if (statInfo[s].isMax)
+                totals[s] = max(totals[s], v);
+            else
+                totals[s] += v;
+        }
+}
+
+void statsReset()
+{
+    lock_guard<mutex> lock(registryMutex);
+    for (const unique_ptr<StatBlock>& block : registry)
+        for (int s = 0; s < NSTATS; s++)
+            block->value[s].store(0, memory_order_relaxed);
+}
+
+const char* statName(StatCounter s)
+{
+    return statInfo[s].name;
+}
+
+bool statIsMax(StatCounter s)
+{
+    return statInfo[s].isMax;
+}
+
+void writeStatsReport(ostream& out)
+{
+#ifndef BATTLESHIP_STATS
+    out << "Statistics were not compiled in (build with BATTLESHIP_STATS)." << endl;
+#else
+    long long totals[NSTATS];
+    statsSnapshot(totals);
+    out << "Hot-path statistics:" << endl;
+    for (int s = 0; s < NSTATS; s++)
+        out << "  " << statInfo[s].name << ": " << totals[s] << endl;
+    if (totals[STAT_PLACE_ATTEMPTS] > 0)
+        out << "  placement retry rate: "
+            << double(totals[STAT_PLACE_FAILURES]) / totals[STAT_PLACE_ATTEMPTS]
+            << endl;
+    if (totals[STAT_GUESS_CALLS] > 0)
+        out << "  guesses with no hunt candidate: "
+            << totals[STAT_GUESS_CALLS] - totals[STAT_GUESS_DRAWS] << endl;
+    if (totals[STAT_SHOTS] > 0)
+        out << "  wasted shot rate: "
+            << double(totals[STAT_WASTED_SHOTS]) / totals[STAT_SHOTS] << endl;
+#endif
+}
+
+void writeStatsJson(ostream& out)
+{
+    long long totals[NSTATS];
+    statsSnapshot(totals);
+    out << "{\n";
+#ifdef BATTLESHIP_STATS
+    out << "  \"enabled\": true";
+#else
+    out << "  \"enabled\": false";
+#endif
+    for (int s = 0; s < NSTATS; s++)
+        out << ",\n  \"" << statInfo[s].name << "\": " << totals[s];
+    out << "\n}\n";
+}
+
+void dumpStatsIfRequested()
+{
+    const char* dest = getenv("BATTLESHIP_STATS");
+    if (dest == nullptr  ||  *dest == '\0')
+        return;
+    if (string(dest) == "-")
+    {
+        writeStatsReport(cerr);
+        return;
+    }
+    ofstream out(dest);
+    if (!out)
+    {
+        cerr << "Cannot write statistics to " << dest << endl;
+        return;
+    }
+    writeStatsJson(out);
+}
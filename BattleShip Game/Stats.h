@@ -0,0 +1,102 @@
+#ifndef STATS_INCLUDED
+#define STATS_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+
+// Hot-path counters and timers.  Each thread bumps its own block of
+// counters; the blocks are merged only when a report is produced.  Building
+// without BATTLESHIP_STATS compiles every STAT_* macro away.
+
+enum StatCounter {
+    STAT_GAMES,                 // games started by Game::play
+    STAT_PLACE_ATTEMPTS,        // placeShips calls made by Game::play
+    STAT_PLACE_FAILURES,        // ... of which failed and were retried
+    STAT_BLOCK_DRAWS,           // random cells drawn by Board::block
+    STAT_BLOCK_REJECTIONS,      // ... of which were already blocked
+    STAT_PLACE_A_SHIP_CALLS,    // placeAShip invocations (all depths)
+    STAT_PLACE_A_SHIP_DEPTH,    // deepest placeAShip recursion seen (max)
+    STAT_GUESS_CALLS,           // GoodPlayer::makeAGuess calls
+    STAT_GUESS_DRAWS,           // ... of which drew a hunt candidate
+    STAT_SHOTS,                 // shots fired
+    STAT_WASTED_SHOTS,          // ... of which were invalid
+    STAT_PLACEMENT_NS,          // time spent placing fleets in Game::play
+    STAT_GAME_NS,               // total time spent in Game::play
+    STAT_LAYOUT_WAITS,          // games that waited for a pre-placed fleet
+    NSTATS
+};
+
+struct StatBlock
+{
+    std::atomic<long long> value[NSTATS];
+};
+
+  // Return the calling thread's block, registering it on first use
+StatBlock* registerThreadStats();
+
+inline StatBlock& threadStats()
+{
+    thread_local StatBlock* block = nullptr;
+    if (block == nullptr)
+        block = registerThreadStats();
+    return *block;
+}
+
+  // Only the owning thread writes a block, so a relaxed load and store
+  // suffices; readers merging blocks never see a torn value.
+inline void statAdd(StatCounter s, long long n)
+{
+    std::atomic<long long>& v = threadStats().value[s];
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void statMax(StatCounter s, long long n)
+{
+    std::atomic<long long>& v = threadStats().value[s];
+    if (n > v.load(std::memory_order_relaxed))
+        v.store(n, std::memory_order_relaxed);
+}
+
+  // Adds the lifetime of the object, in nanoseconds, to a counter
+class StatTimer
+{
+  public:
+    StatTimer(StatCounter s) : m_stat(s), m_start(std::chrono::steady_clock::now()) {}
+    ~StatTimer()
+    {
+        statAdd(m_stat, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_start).count());
+    }
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+  private:
+    StatCounter m_stat;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#ifdef BATTLESHIP_STATS
+#define STAT_ADD(s, n) statAdd((s), (n))
+#define STAT_MAX(s, n) statMax((s), (n))
+#define STAT_TIME_CONCAT2(a, b) a##b
+#define STAT_TIME_CONCAT(a, b) STAT_TIME_CONCAT2(a, b)
+#define STAT_TIME(s) StatTimer STAT_TIME_CONCAT(statTimer_, __LINE__)(s)
+#else
+#define STAT_ADD(s, n) ((void)0)
+#define STAT_MAX(s, n) ((void)0)
+#define STAT_TIME(s) ((void)0)
+#endif
+
+  // Merge every thread's block into totals[0..NSTATS-1]
+void statsSnapshot(long long totals[NSTATS]);
+void statsReset();
+const char* statName(StatCounter s);
+bool statIsMax(StatCounter s);      // merged by max rather than by sum
+void writeStatsReport(std::ostream& out);
+void writeStatsJson(std::ostream& out);
+
+  // If the BATTLESHIP_STATS environment variable names a file, write the
+  // JSON report there ("-" writes the text report to stderr).
+void dumpStatsIfRequested();
+
+#endif // STATS_INCLUDED
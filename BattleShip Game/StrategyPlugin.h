@@ -0,0 +1,76 @@
+/*
+ * StrategyPlugin.h -- ABI for player strategies loaded from shared objects.
+ *
+ * A plugin is a shared library exporting
+ *
+ *     const bs_strategy* bs_plugin_strategies(int* count);
+ *
+ * which returns an array of *count strategy descriptors that stay valid
+ * for the life of the process.  Each descriptor's name becomes a type that
+ * createPlayer accepts.  The engine rejects descriptors whose abi_version
+ * differs from BS_STRATEGY_ABI_VERSION, so the layout below may only change
+ * together with that number.  Only C types cross the boundary.
+ */
+
+#ifndef STRATEGYPLUGIN_INCLUDED
+#define STRATEGYPLUGIN_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BS_STRATEGY_ABI_VERSION 1
+
+#if defined(_WIN32)
+#  define BS_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#  define BS_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+/* What a strategy instance learns about its game when it is created */
+typedef struct bs_game_info
+{
+    int rows;
+    int cols;
+    int n_ships;
+    const int* ship_lengths;        /* n_ships entries, indexed by ship id */
+    int (*rand_int)(int limit);     /* the engine's seeded generator: 0..limit-1 */
+} bs_game_info;
+
+/* The player's own board, passed to place_ships */
+typedef struct bs_board_ops
+{
+    void* board;
+    void (*clear)(void* board);
+    void (*block)(void* board);
+    void (*unblock)(void* board);
+    int (*place_ship)(void* board, int r, int c, int ship_id, int vertical);
+    int (*unplace_ship)(void* board, int r, int c, int ship_id, int vertical);
+} bs_board_ops;
+
+typedef struct bs_strategy
+{
+    int abi_version;                /* BS_STRATEGY_ABI_VERSION */
+    const char* name;
+
+    /* NULL declines the game (out of memory, unsupported board, ...);
+       createPlayer then fails for this type and no other callback is made */
+    void* (*create)(const bs_game_info* game);
+    void (*destroy)(void* self);
+
+    int (*place_ships)(void* self, const bs_board_ops* board);
+    void (*recommend_attack)(void* self, int* r, int* c);
+    void (*record_attack_result)(void* self, int r, int c, int valid_shot,
+                                 int shot_hit, int ship_destroyed, int ship_id);
+    void (*record_attack_by_opponent)(void* self, int r, int c);
+} bs_strategy;
+
+typedef const bs_strategy* (*bs_plugin_entry)(int* count);
+
+#define BS_PLUGIN_ENTRY_NAME "bs_plugin_strategies"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STRATEGYPLUGIN_INCLUDED */
@@ -0,0 +1,567 @@
+#include "Tournament.h"
+#include "AsyncPlayer.h"
+#include "Game.h"
+#include "LayoutPipeline.h"
+#include "Layouts.h"
+#include "Player.h"
+#include "Results.h"
+#include "globals.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+bool addStandardShips(Game& g)
+{
+    return g.addShip(5, 'A', "aircraft carrier")  &&
+           g.addShip(4, 'B', "battleship")  &&
+           g.addShip(3, 'D', "destroyer")  &&
+           g.addShip(3, 'S', "submarine")  &&
+           g.addShip(2, 'P', "patrol boat");
+}
+
+unsigned int gameSeed(unsigned long long seed, long long game)
+{
+      // splitmix64 finalizer over the pair, so nearby games get unrelated seeds
+    unsigned long long z = seed + 0x9e3779b97f4a7c15ULL * (game + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return static_cast<unsigned int>(z ^ (z >> 32));
+}
+
+unsigned int layoutSeed(unsigned long long seed, long long game)
+{
+    return gameSeed(seed ^ 0x6a09e667f3bcc909ULL, game);
+}
+
+namespace {
+
+  // Forwards to another player, counting the shots it recommends
+class ShotCounter : public Player
+{
+  public:
+    ShotCounter(Player* p, const Game& g)
+     : Player(p->name(), g), m_player(p), m_shots(0)
+    {}
+    virtual bool isHuman() const { return m_player->isHuman(); }
+    virtual bool placeShips(Board& b) { return m_player->placeShips(b); }
+    virtual Point recommendAttack()
+    {
+        m_shots++;
+        return m_player->recommendAttack();
+    }
+    virtual vector<Point> recommendAttacks(int k)
+    {
+        vector<Point> shots = m_player->recommendAttacks(k);
+        m_shots += static_cast<int>(shots.size());
+        return shots;
+    }
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId)
+    {
+        m_player->recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+    }
+    virtual void recordAttackByOpponent(Point p)
+    {
+        m_player->recordAttackByOpponent(p);
+    }
+    virtual void setOpponentView(const ShotView* view)
+    {
+        Player::setOpponentView(view);
+        m_player->setOpponentView(view);
+    }
+    int shots() const { return m_shots; }
+  private:
+    Player* m_player;
+    int m_shots;
+};
+
+  // Forwards to another player, except that it sets out a fleet placed
+  // beforehand instead of placing one
+class PrePlacedPlayer : public Player
+{
+  public:
+    PrePlacedPlayer(Player* p, const Game& g, const ShipPlacement* fleet)
+     : Player(p->name(), g), m_player(p), m_fleet(fleet)
+    {}
+    virtual bool isHuman() const { return m_player->isHuman(); }
+    virtual bool placeShips(Board& b)
+    {
+        return m_fleet != nullptr  &&  placeLayout(b, m_fleet, game().nShips());
+    }
+    virtual Point recommendAttack() { return m_player->recommendAttack(); }
+    virtual vector<Point> recommendAttacks(int k) { return m_player->recommendAttacks(k); }
+    virtual void recordAttackResult(Point p, bool validShot, bool shotHit,
+                                    bool shipDestroyed, int shipId)
+    {
+        m_player->recordAttackResult(p, validShot, shotHit, shipDestroyed, shipId);
+    }
+    virtual void recordAttackByOpponent(Point p)
+    {
+        m_player->recordAttackByOpponent(p);
+    }
+    virtual void setOpponentView(const ShotView* view)
+    {
+        Player::setOpponentView(view);
+        m_player->setOpponentView(view);
+    }
+  private:
+    Player* m_player;
+    const ShipPlacement* m_fleet;
+};
+
+}  // namespace
+
+GameRecord playSeriesGame(Game& g, const string& type1, const string& type2,
+                          unsigned long long seed, long long k,
+                          const PrePlacedFleets* fleets)
+{
+    TraceSpan span("game", k);
+    seedRandom(gameSeed(seed, k));
+    GameRecord rec = { 0, 0 };
+    Player* p1 = createPlayer(type1, type1 + " (1)", g);
+    Player* p2 = createPlayer(type2, type2 + " (2)", g);
+    if (p1 != nullptr  &&  p2 != nullptr  &&  fleets != nullptr)
+    {
+        PrePlacedPlayer f1(p1, g, fleets->fleet1);
+        PrePlacedPlayer f2(p2, g, fleets->fleet2);
+        ShotCounter c1(&f1, g);
+        ShotCounter c2(&f2, g);
+        Player* winner = (k % 2 == 0 ? g.play(&c1, &c2, false, false)
+                                     : g.play(&c2, &c1, false, false));
+        if (winner == &c1)
+            rec = { 1, c1.shots() };
+        else if (winner == &c2)
+            rec = { 2, c2.shots() };
+    }
+    else if (p1 != nullptr  &&  p2 != nullptr)
+    {
+        ShotCounter c1(p1, g);
+        ShotCounter c2(p2, g);
+        Player* winner = (k % 2 == 0 ? g.play(&c1, &c2, false, false)
+                                     : g.play(&c2, &c1, false, false));
+        if (winner == &c1)
+            rec = { 1, c1.shots() };
+        else if (winner == &c2)
+            rec = { 2, c2.shots() };
+    }
+    delete p1;
+    delete p2;
+    return rec;
+}
+
+namespace {
+
+void addHistogram(vector<long long>& total, const vector<long long>& h)
+{
+    if (total.size() < h.size())
+        total.resize(h.size(), 0);
+    for (size_t s = 0; s < h.size(); s++)
+        total[s] += h[s];
+}
+
+}  // namespace
+
+void addGame(TournamentResult& r, const GameRecord& rec)
+{
+    r.games++;
+    if (rec.winner == 0)
+    {
+        r.unfinished++;
+        return;
+    }
+    vector<long long>& h = (rec.winner == 1 ? r.shots1 : r.shots2);
+    if (rec.winner == 1)
+        r.wins1++;
+    else
+        r.wins2++;
+    if (h.size() <= size_t(rec.shots))
+        h.resize(rec.shots + 1, 0);
+    h[rec.shots]++;
+}
+
+void addResult(TournamentResult& total, const TournamentResult& r)
+{
+    total.games += r.games;
+    total.wins1 += r.wins1;
+    total.wins2 += r.wins2;
+    total.unfinished += r.unfinished;
+    addHistogram(total.shots1, r.shots1);
+    addHistogram(total.shots2, r.shots2);
+}
+
+void shardRange(long long firstGame, long long nGames, int index, int count,
+                long long& first, long long& end)
+{
+      // Shard sizes differ by at most one game
+    long long base = nGames / count;
+    long long extra = nGames % count;
+    first = firstGame + index * base + min<long long>(index, extra);
+    end = first + base + (index < extra ? 1 : 0);
+}
+
+namespace {
+
+const long long CHUNK = 16;     // games a worker claims at a time
+
+  // Play game number k and add its outcome to result.  With a producer,
+  // the fleets come from its ring.
+void playOneGame(const TournamentConfig& config, long long k, TournamentResult& result,
+                 LayoutProducer* producer)
+{
+    Game g(config.rows, config.cols);
+    addStandardShips(g);
+    g.setShotsPerTurn(config.shotsPerTurn);
+    if (producer == nullptr)
+    {
+        addGame(result, playSeriesGame(g, config.type1, config.type2, config.seed, k));
+        return;
+    }
+    vector<ShipPlacement> fleet1;
+    vector<ShipPlacement> fleet2;
+    bool ok1, ok2;
+    producer->ring().take(k, fleet1, ok1, fleet2, ok2);
+    PrePlacedFleets fleets;
+    fleets.fleet1 = ok1 ? fleet1.data() : nullptr;
+    fleets.fleet2 = ok2 ? fleet2.data() : nullptr;
+    addGame(result, playSeriesGame(g, config.type1, config.type2, config.seed, k,
+                                   &fleets));
+}
+
+  // playOneGame through the awaitable interface; the outcome is stored for
+  // the caller to tally
+Task<void> playOneGameAsync(const TournamentConfig& config, long long k, GameRecord& outcome)
+{
+    TraceSpan span("game", k);
+    seedRandom(gameSeed(config.seed, k));
+    Game g(config.rows, config.cols);
+    addStandardShips(g);
+    g.setShotsPerTurn(config.shotsPerTurn);
+    Player* p1 = createPlayer(config.type1, config.type1 + " (1)", g);
+    Player* p2 = createPlayer(config.type2, config.type2 + " (2)", g);
+    outcome = { 0, 0 };
+    if (p1 != nullptr  &&  p2 != nullptr)
+    {
+        ShotCounter c1(p1, g);
+        ShotCounter c2(p2, g);
+        SyncPlayerAdapter a1(&c1);
+        SyncPlayerAdapter a2(&c2);
+        AsyncPlayer* winner = (k % 2 == 0 ? co_await g.playAsync(&a1, &a2)
+                                          : co_await g.playAsync(&a2, &a1));
+        if (winner == &a1)
+            outcome = { 1, c1.shots() };
+        else if (winner == &a2)
+            outcome = { 2, c2.shots() };
+    }
+    delete p1;
+    delete p2;
+}
+
+TournamentResult runAsyncTournament(const TournamentConfig& config, int nThreads)
+{
+    vector<GameRecord> outcomes(config.nGames);
+    {
+        GamePool pool(nThreads);
+        for (long long i = 0; i < config.nGames; i++)
+            pool.spawn(playOneGameAsync(config, config.firstGame + i, outcomes[i]));
+        pool.waitIdle();
+    }
+    TournamentResult r;
+    for (const GameRecord& o : outcomes)
+        addGame(r, o);
+    return r;
+}
+
+TournamentResult runThreadedTournament(const TournamentConfig& config, int nThreads)
+{
+    atomic<long long> next(config.firstGame);
+    const long long end = config.firstGame + config.nGames;
+    TournamentResult total;
+    mutex totalMutex;
+
+    unique_ptr<LayoutProducer> producer;
+    if (config.layoutWorkers > 0)
+        producer.reset(new LayoutProducer(config.type1, config.type2,
+                                          config.rows, config.cols, config.seed,
+                                          config.firstGame, end,
+                                          config.layoutWorkers,
+                                          max(1, config.layoutBuffer)));
+
+    vector<thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back([&, t]() {
+            traceThreadName("worker " + to_string(t));
+            TournamentResult local;
+            for (;;)
+            {
+                long long first = next.fetch_add(CHUNK);
+                if (first >= end)
+                    break;
+                for (long long k = first; k < first + CHUNK  &&  k < end; k++)
+                    playOneGame(config, k, local, producer.get());
+            }
+            lock_guard<mutex> lock(totalMutex);
+            addResult(total, local);
+        });
+    for (thread& w : workers)
+        w.join();
+    return total;
+}
+
+}  // namespace
+
+TournamentResult runTournament(const TournamentConfig& config)
+{
+    int nThreads = config.nThreads;
+    if (nThreads <= 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+    if (!config.traceFile.empty())
+        startTrace();
+
+    TournamentResult total;
+    if (config.async)
+        total = runAsyncTournament(config, nThreads);
+    else
+        total = runThreadedTournament(config, nThreads);
+
+    if (!config.traceFile.empty())
+    {
+        stopTrace();
+        if (!writeTrace(config.traceFile))
+            cerr << "Cannot write trace to " << config.traceFile << endl;
+    }
+    return total;
+}
+
+namespace {
+
+  // Play games [first, end) of config's series in segments of every games,
+  // saving the results so far to the results file at path after each
+  // segment.  Games an earlier run already saved there are not replayed;
+  // since each game is seeded on its own, the final totals are the same as
+  // those of an uninterrupted run.
+bool runCheckpointed(TournamentConfig config, long long first, long long end,
+                     const string& path, long long every, SeriesResults& progress)
+{
+    progress = seriesResults(config, first, first, TournamentResult());
+    long long saved[NSTATS] = {};
+    string error;
+    SeriesResults previous;
+    if (ifstream(path))
+    {
+        if (!readResults(path, previous, error)  ||
+            !mergeResults(progress, previous, error))
+        {
+            cerr << "Cannot resume from " << path << ": " << error << endl;
+            return false;
+        }
+        for (const pair<long long, long long>& g : progress.ranges)
+            if (g.first < first  ||  g.second > end)
+            {
+                cerr << path << " records games outside this run" << endl;
+                return false;
+            }
+        copy(previous.stats, previous.stats + NSTATS, saved);
+        cerr << "Resuming: " << progress.result.games << " of " << end - first
+             << " games already played" << endl;
+    }
+
+      // The games not yet played, in order
+    vector<pair<long long, long long>> todo;
+    long long k = first;
+    for (const pair<long long, long long>& g : progress.ranges)
+    {
+        if (k < g.first)
+            todo.push_back(make_pair(k, g.first));
+        k = g.second;
+    }
+    if (k < end)
+        todo.push_back(make_pair(k, end));
+
+    long long base[NSTATS];
+    statsSnapshot(base);
+    for (const pair<long long, long long>& gap : todo)
+        for (long long k = gap.first; k < gap.second; k += every)
+        {
+            config.firstGame = k;
+            config.nGames = min(every, gap.second - k);
+            SeriesResults segment = seriesResults(config, k, k + config.nGames,
+                                                  runTournament(config));
+            fill(segment.stats, segment.stats + NSTATS, 0);
+            if (!mergeResults(progress, segment, error))
+            {
+                cerr << error << endl;
+                return false;
+            }
+
+              // Counters: those saved by earlier runs plus this run's so far
+            long long now[NSTATS];
+            statsSnapshot(now);
+            for (int s = 0; s < NSTATS; s++)
+                if (!statIsMax(StatCounter(s)))
+                    now[s] -= base[s];
+            copy(saved, saved + NSTATS, progress.stats);
+            mergeStats(progress.stats, now);
+            if (!writeResults(path, progress))
+            {
+                cerr << "Cannot write checkpoint " << path << endl;
+                return false;
+            }
+        }
+    return true;
+}
+
+}  // namespace
+
+int tournamentMain(int argc, char* argv[])
+{
+    TournamentConfig config;
+    int shardIndex = 0;
+    int shardCount = 1;
+    string outPath;
+    string checkpointPath;
+    long long checkpointEvery = 1000;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--async")
+        {
+            config.async = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for " << arg << endl;
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--p1")
+            config.type1 = value;
+        else if (arg == "--p2")
+            config.type2 = value;
+        else if (arg == "--games")
+            config.nGames = atoll(value.c_str());
+        else if (arg == "--first")
+            config.firstGame = atoll(value.c_str());
+        else if (arg == "--seed")
+            config.seed = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads")
+            config.nThreads = atoi(value.c_str());
+        else if (arg == "--rows")
+            config.rows = atoi(value.c_str());
+        else if (arg == "--cols")
+            config.cols = atoi(value.c_str());
+        else if (arg == "--trace")
+            config.traceFile = value;
+        else if (arg == "--salvo")
+        {
+            config.shotsPerTurn = (value == "ships" ? SHOTS_PER_SHIP : atoi(value.c_str()));
+            if (value != "ships"  &&  config.shotsPerTurn < 1)
+            {
+                cerr << "--salvo takes a positive number of shots or \"ships\"" << endl;
+                return 2;
+            }
+        }
+        else if (arg == "--shard")
+        {
+            char slash = 0;
+            istringstream iss(value);
+            if (!(iss >> shardIndex >> slash >> shardCount)  ||  slash != '/'  ||
+                shardCount < 1  ||  shardIndex < 0  ||  shardIndex >= shardCount)
+            {
+                cerr << "--shard takes I/N with 0 <= I < N" << endl;
+                return 2;
+            }
+        }
+        else if (arg == "--out")
+            outPath = value;
+        else if (arg == "--layout-workers")
+            config.layoutWorkers = atoi(value.c_str());
+        else if (arg == "--layout-buffer")
+            config.layoutBuffer = atoi(value.c_str());
+        else if (arg == "--checkpoint")
+            checkpointPath = value;
+        else if (arg == "--checkpoint-every")
+            checkpointEvery = atoll(value.c_str());
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            cerr << "usage: tournament [--p1 TYPE] [--p2 TYPE] [--games N]"
+                 << " [--first K] [--seed S] [--threads T] [--rows R]"
+                 << " [--cols C] [--salvo K|ships] [--trace FILE] [--async]"
+                 << " [--shard I/N] [--out FILE] [--checkpoint FILE]"
+                 << " [--checkpoint-every N] [--layout-workers N]"
+                 << " [--layout-buffer N]" << endl;
+            return 2;
+        }
+    }
+    if (config.nGames < 0)
+    {
+        cerr << "Number of games must be >= 0" << endl;
+        return 2;
+    }
+    if (checkpointEvery <= 0)
+    {
+        cerr << "--checkpoint-every must be positive" << endl;
+        return 2;
+    }
+    if (config.layoutWorkers > 0  &&  config.async)
+    {
+        cerr << "--layout-workers cannot be combined with --async" << endl;
+        return 2;
+    }
+    if (!checkpointPath.empty()  &&  !config.traceFile.empty())
+    {
+        cerr << "--trace cannot be combined with --checkpoint" << endl;
+        return 2;
+    }
+    vector<string> types = playerTypes();
+    for (const string& t : { config.type1, config.type2 })
+    {
+        if (find(types.begin(), types.end(), t) == types.end())
+        {
+            cerr << "Unknown player type " << t << "; available:";
+            for (const string& name : types)
+                cerr << " " << name;
+            cerr << endl;
+            return 2;
+        }
+    }
+
+      // A shard plays its slice of the series; the results files of all
+      // the shards merge into the result of the whole series
+    long long first, end;
+    shardRange(config.firstGame, config.nGames, shardIndex, shardCount, first, end);
+    config.firstGame = first;
+    config.nGames = end - first;
+
+    SeriesResults results;
+    if (checkpointPath.empty())
+        results = seriesResults(config, first, end, runTournament(config));
+    else if (!runCheckpointed(config, first, end, checkpointPath,
+                              checkpointEvery, results))
+        return 1;
+    if (!outPath.empty()  &&  !writeResults(outPath, results))
+    {
+        cerr << "Cannot write results to " << outPath << endl;
+        return 1;
+    }
+    const TournamentResult& r = results.result;
+    cout << config.type1 << " (1) won " << r.wins1 << ", " << config.type2
+         << " (2) won " << r.wins2 << " out of " << r.games << " games";
+    if (r.unfinished > 0)
+        cout << " (" << r.unfinished << " unfinished)";
+    cout << "." << endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef TOURNAMENT_INCLUDED
+#define TOURNAMENT_INCLUDED
+
+#include <string>
+#include <vector>
+
+class Game;
+struct ShipPlacement;
+
+  // Add the five ships of the standard fleet to g
+bool addStandardShips(Game& g);
+
+struct TournamentConfig
+{
+    std::string type1 = "good";
+    std::string type2 = "mediocre";
+    int rows = 10;
+    int cols = 10;
+    int shotsPerTurn = 1;       // see Game::setShotsPerTurn
+      // Games are numbered, and game k is seeded from (seed, k) alone, so
+      // any range of games can be replayed exactly on any thread.
+    long long firstGame = 0;
+    long long nGames = 1000;
+    unsigned long long seed = 1;
+    int nThreads = 0;           // 0 means one per hardware thread
+    std::string traceFile;      // Chrome trace-event output, if not empty
+    bool async = false;         // run games as coroutines on a GamePool
+      // If positive, fleets are placed ahead of play by this many producer
+      // threads (see LayoutPipeline.h), with up to layoutBuffer games'
+      // fleets waiting.  The fleets then come from their own random stream,
+      // so results differ from, but are as reproducible as, those of
+      // ordinary play.
+    int layoutWorkers = 0;
+    int layoutBuffer = 256;
+};
+
+struct TournamentResult
+{
+    long long games = 0;
+    long long wins1 = 0;        // games won by a type1 player
+    long long wins2 = 0;        // games won by a type2 player
+    long long unfinished = 0;   // games where play() returned nullptr
+      // shotsN[s] is the number of games typeN won firing s shots; the
+      // vectors grow to the longest game seen
+    std::vector<long long> shots1;
+    std::vector<long long> shots2;
+};
+
+  // Add the games in r to total
+void addResult(TournamentResult& total, const TournamentResult& r);
+
+  // Seed for the random number generator of one game
+unsigned int gameSeed(unsigned long long seed, long long game);
+
+  // Seed for placing the fleets of one game ahead of play
+unsigned int layoutSeed(unsigned long long seed, long long game);
+
+struct GameRecord
+{
+    int winner;     // 1 or 2 for the type that won, 0 if unfinished
+    int shots;      // shots fired by the winner, 0 if unfinished
+};
+
+  // Add one game to r
+void addGame(TournamentResult& r, const GameRecord& rec);
+
+  // Fleets placed ahead of play; a null fleet is one that could not be
+  // placed
+struct PrePlacedFleets
+{
+    const ShipPlacement* fleet1 = nullptr;     // type1's fleet
+    const ShipPlacement* fleet2 = nullptr;     // type2's fleet
+};
+
+  // Play game number k of a series between type1 and type2 on g, seeded
+  // from (seed, k).  type1 moves first in the even-numbered games.  If
+  // fleets is given, the players start from those fleets rather than
+  // placing their own.  Safe to call from several threads on the same Game.
+GameRecord playSeriesGame(Game& g, const std::string& type1,
+                          const std::string& type2, unsigned long long seed,
+                          long long k, const PrePlacedFleets* fleets = nullptr);
+
+  // Play games firstGame .. firstGame+nGames-1 on a pool of worker threads.
+  // Players alternate who moves first: type1 starts the even-numbered games.
+TournamentResult runTournament(const TournamentConfig& config);
+
+  // Games [first, end) of the series that shard index of count plays when
+  // the games firstGame .. firstGame+nGames-1 are split between count
+  // processes.  The split depends only on its arguments.
+void shardRange(long long firstGame, long long nGames, int index, int count,
+                long long& first, long long& end);
+
+  // Entry point for "battleship tournament [options]"
+int tournamentMain(int argc, char* argv[]);
+
+#endif // TOURNAMENT_INCLUDED
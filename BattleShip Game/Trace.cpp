@@ -0,0 +1,168 @@
+#include "Trace.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+atomic<bool> g_traceEnabled(false);
+
+namespace {
+
+struct TraceEvent
+{
+    const char* name;
+    long long startNs;
+    long long durNs;
+    int detail;
+    long long id;
+};
+
+  // One per recording thread.  Only the owner appends; writeTrace reads
+  // the buffers after the workers have finished.
+struct TraceBuffer
+{
+    int tid;
+    string threadName;
+    vector<TraceEvent> events;
+    vector<string> details;
+    unordered_map<string, int> detailIndex;
+};
+
+mutex traceMutex;
+vector<unique_ptr<TraceBuffer>> buffers;
+chrono::steady_clock::time_point traceEpoch;
+
+TraceBuffer& threadBuffer()
+{
+    thread_local TraceBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        lock_guard<mutex> lock(traceMutex);
+        buffers.emplace_back(new TraceBuffer);
+        buffer = buffers.back().get();
+        buffer->tid = static_cast<int>(buffers.size());
+    }
+    return *buffer;
+}
+
+long long nowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+                        chrono::steady_clock::now() - traceEpoch).count();
+}
+
+void writeEscaped(ostream& out, const string& s)
+{
+    for (char ch : s)
+    {
+        if (ch == '"'  ||  ch == '\\')
+            out << '\\' << ch;
+        else if (static_cast<unsigned char>(ch) < 0x20)
+            out << ' ';
+        else
+            out << ch;
+    }
+}
+
+}  // namespace
+
+void startTrace()
+{
+    {
+        lock_guard<mutex> lock(traceMutex);
+        traceEpoch = chrono::steady_clock::now();
+    }
+    g_traceEnabled.store(true);
+}
+
+void stopTrace()
+{
+    g_traceEnabled.store(false);
+}
+
+void traceThreadName(const string& name)
+{
+    if (traceEnabled())
+        threadBuffer().threadName = name;
+}
+
+void TraceSpan::begin(const char* name, const string& detail)
+{
+    m_name = name;
+    m_id = -1;
+    m_detail = -1;
+    if (!detail.empty())
+    {
+        TraceBuffer& buf = threadBuffer();
+        unordered_map<string, int>::iterator it = buf.detailIndex.find(detail);
+        if (it == buf.detailIndex.end())
+        {
+            it = buf.detailIndex.emplace(detail, static_cast<int>(buf.details.size())).first;
+            buf.details.push_back(detail);
+        }
+        m_detail = it->second;
+    }
+    m_startNs = nowNs();
+}
+
+void TraceSpan::begin(const char* name, long long id)
+{
+    m_name = name;
+    m_id = id;
+    m_detail = -1;
+    m_startNs = nowNs();
+}
+
+void TraceSpan::end()
+{
+    long long endNs = nowNs();
+    threadBuffer().events.push_back(
+                TraceEvent{m_name, m_startNs, endNs - m_startNs, m_detail, m_id});
+}
+
+bool writeTrace(const string& path)
+{
+    ofstream out(path);
+    if (!out)
+        return false;
+    lock_guard<mutex> lock(traceMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const unique_ptr<TraceBuffer>& buf : buffers)
+    {
+        if (!buf->threadName.empty())
+        {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << buf->tid << ",\"args\":{\"name\":\"";
+            writeEscaped(out, buf->threadName);
+            out << "\"}}";
+        }
+        for (const TraceEvent& e : buf->events)
+        {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << buf->tid << ",\"ts\":" << e.startNs / 1000 << '.'
+                << (e.startNs % 1000) / 100 << ",\"dur\":" << e.durNs / 1000
+                << '.' << (e.durNs % 1000) / 100;
+            if (e.detail >= 0)
+            {
+                out << ",\"args\":{\"player\":\"";
+                writeEscaped(out, buf->details[e.detail]);
+                out << "\"}";
+            }
+            else if (e.id >= 0)
+                out << ",\"args\":{\"game\":" << e.id << "}";
+            out << "}";
+        }
+        buf->events.clear();
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,66 @@
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+#include <atomic>
+#include <string>
+
+// Optional Chrome/Perfetto trace-event recording.  Spans are appended to a
+// buffer owned by the recording thread; writeTrace merges every buffer into
+// one JSON file that chrome://tracing or ui.perfetto.dev can open.  While
+// tracing is disabled a span costs one relaxed load.
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool traceEnabled()
+{
+    return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+  // Start recording; timestamps are relative to this call
+void startTrace();
+void stopTrace();
+
+  // Name the calling thread in the trace viewer
+void traceThreadName(const std::string& name);
+
+  // Write every recorded event, then discard them.  Returns false if the
+  // file cannot be written.
+bool writeTrace(const std::string& path);
+
+  // Records a complete ("X") event covering the lifetime of the object.
+  // name must be a string literal; detail, if given, is copied.
+class TraceSpan
+{
+  public:
+    TraceSpan(const char* name, const std::string& detail = std::string())
+     : m_name(nullptr)
+    {
+        if (traceEnabled())
+            begin(name, detail);
+    }
+    TraceSpan(const char* name, long long id)
+     : m_name(nullptr)
+    {
+        if (traceEnabled())
+            begin(name, id);
+    }
+    ~TraceSpan()
+    {
+        if (m_name != nullptr)
+            end();
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+  private:
+    void begin(const char* name, const std::string& detail);
+    void begin(const char* name, long long id);
+    void end();
+
+    const char* m_name;
+    long long m_startNs;
+    int m_detail;       // index of interned detail string, or -1
+    long long m_id;     // numeric argument, or -1
+};
+
+#endif // TRACE_INCLUDED
@@ -0,0 +1,516 @@
+#include "Tuning.h"
+#include "Board.h"
+#include "Game.h"
+#include "Layouts.h"
+#include "Player.h"
+#include "Tournament.h"
+#include "globals.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//*********************************************************************
+//  Parameters files
+//*********************************************************************
+
+namespace {
+
+PlayerParams loaded;
+
+const char* const HEADER = "battleship-params 1";
+
+string formatFraction(double x)
+{
+    ostringstream oss;
+    oss << setprecision(4) << x;
+    return oss.str();
+}
+
+  // The keys and values of the parameters of one player type
+vector<pair<string, string>> paramFields(const string& type, const PlayerParams& params)
+{
+    vector<pair<string, string>> fields;
+    if (type == "mediocre")
+    {
+        fields.push_back(make_pair("mediocre.crossRadius",
+                                   to_string(params.mediocre.crossRadius)));
+        fields.push_back(make_pair("mediocre.blockFraction",
+                                   formatFraction(params.mediocre.blockFraction)));
+    }
+    else if (type == "good")
+    {
+        const int* order = params.good.probeOrder;
+        fields.push_back(make_pair("good.paritySpacing",
+                                   to_string(params.good.paritySpacing)));
+        fields.push_back(make_pair("good.probeOrder",
+                                   to_string(order[0]) + " " + to_string(order[1]) + " " +
+                                   to_string(order[2]) + " " + to_string(order[3])));
+        fields.push_back(make_pair("good.blockFraction",
+                                   formatFraction(params.good.blockFraction)));
+    }
+    return fields;
+}
+
+  // Parse the value of key from iss into params
+bool readField(const string& key, istringstream& iss, PlayerParams& params, string& error)
+{
+    bool ok;
+    if (key == "mediocre.crossRadius")
+          // MediocrePlayer lists the cells this far out along the hit's row
+          // and column; no farther can be on the board
+        ok = (iss >> params.mediocre.crossRadius)  &&  params.mediocre.crossRadius >= 1  &&
+             params.mediocre.crossRadius <= max(MAXROWS, MAXCOLS);
+    else if (key == "mediocre.blockFraction")
+        ok = (iss >> params.mediocre.blockFraction)  &&
+             params.mediocre.blockFraction >= 0  &&  params.mediocre.blockFraction < 1;
+    else if (key == "good.paritySpacing")
+          // GoodPlayer counts cells per residue class in an array this big
+        ok = (iss >> params.good.paritySpacing)  &&  params.good.paritySpacing >= 0  &&
+             params.good.paritySpacing <= MAXROWS + MAXCOLS;
+    else if (key == "good.probeOrder")
+    {
+        int* order = params.good.probeOrder;
+        ok = bool(iss >> order[0] >> order[1] >> order[2] >> order[3]);
+        bool seen[4] = {};
+        for (int k = 0; ok  &&  k < 4; k++)
+        {
+            ok = order[k] >= 0  &&  order[k] < 4  &&  !seen[order[k]];
+            if (ok)
+                seen[order[k]] = true;
+        }
+    }
+    else if (key == "good.blockFraction")
+        ok = (iss >> params.good.blockFraction)  &&
+             params.good.blockFraction >= 0  &&  params.good.blockFraction < 1;
+    else
+    {
+        error = "unknown parameter " + key;
+        return false;
+    }
+    string extra;
+    if (ok  &&  iss >> extra)
+        ok = false;
+    if (!ok)
+        error = "bad value for " + key;
+    return ok;
+}
+
+uint64_t hashParams(const PlayerParams& params)
+{
+    const MediocreParams& m = params.mediocre;
+    const GoodParams& g = params.good;
+    uint64_t h = fingerprint(&m.crossRadius, sizeof(m.crossRadius));
+    h = fingerprint(&m.blockFraction, sizeof(m.blockFraction), h);
+    h = fingerprint(&g.paritySpacing, sizeof(g.paritySpacing), h);
+    h = fingerprint(g.probeOrder, sizeof(g.probeOrder), h);
+    return fingerprint(&g.blockFraction, sizeof(g.blockFraction), h);
+}
+
+}  // namespace
+
+const PlayerParams& playerParams()
+{
+    return loaded;
+}
+
+uint64_t playerParamsFingerprint()
+{
+    uint64_t h = hashParams(loaded);
+    return h == hashParams(PlayerParams()) ? 0 : h;
+}
+
+bool writePlayerParams(const string& path, const PlayerParams& params)
+{
+      // As writeResults does, so a failed write never clobbers the file
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp);
+        if (!out)
+            return false;
+        out << HEADER << "\n";
+        for (const char* type : { "mediocre", "good" })
+            for (const pair<string, string>& f : paramFields(type, params))
+                out << f.first << " " << f.second << "\n";
+        out << "end\n";
+        if (!out.flush())
+        {
+            out.close();
+            remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readPlayerParams(const string& path, PlayerParams& params, string& error)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        error = "cannot read " + path;
+        return false;
+    }
+    string line;
+    if (!getline(in, line)  ||  line != HEADER)
+    {
+        error = path + " is not a parameters file";
+        return false;
+    }
+    PlayerParams p;
+    while (getline(in, line))
+    {
+        istringstream iss(line);
+        string key;
+        if (!(iss >> key))
+            continue;
+        if (key == "end")
+        {
+            params = p;
+            return true;
+        }
+        if (!readField(key, iss, p, error))
+        {
+            error = path + ": " + error;
+            return false;
+        }
+    }
+    error = path + " is truncated";
+    return false;
+}
+
+void loadPlayerParamsFromEnv()
+{
+    const char* path = getenv("BATTLESHIP_PARAMS");
+    if (path == nullptr  ||  *path == '\0')
+        return;
+    string error;
+    if (!readPlayerParams(path, loaded, error))
+        cerr << "Cannot load player parameters: " << error << endl;
+}
+
+//*********************************************************************
+//  Tuner
+//*********************************************************************
+
+namespace {
+
+struct TuneConfig
+{
+    string type = "good";
+    int population = 16;
+    int generations = 10;
+    long long games = 400;      // layouts each candidate attacks and defends
+    unsigned long long seed = 1;
+    int nThreads = 0;
+    int rows = 10;
+    int cols = 10;
+    string outPath = "battleship.params";
+};
+
+struct Candidate
+{
+    PlayerParams params;
+    bool scored = false;
+    long long attackShots = 0;      // shots it needed to sink the incumbent's fleets
+    long long defenseShots = 0;     // shots the incumbent needed to sink its fleets
+      // Higher is better: on average, how many shots sooner it would finish
+      // a game against the incumbent than the incumbent would
+    double score(long long games) const
+    {
+        return double(defenseShots - attackShots) / games;
+    }
+};
+
+  // Place a fleet with p and record where it went
+bool placeWith(const Game& g, Player* p, vector<ShipPlacement>& fleet)
+{
+    Board b(g);
+    bool placed = false;
+    for (int attempt = 0; p != nullptr  &&  attempt < 50  &&  !placed; attempt++)
+        placed = p->placeShips(b);
+    fleet.resize(g.nShips());
+    for (int k = 0; placed  &&  k < g.nShips(); k++)
+    {
+        Point topOrLeft;
+        Direction dir;
+        placed = b.shipPosition(k, topOrLeft, dir);
+        fleet[k] = ShipPlacement{ uint8_t(topOrLeft.r), uint8_t(topOrLeft.c),
+                                  uint8_t(dir == VERTICAL) };
+    }
+    return placed;
+}
+
+  // Shots attacker needs to sink fleet, charging one more than the board
+  // holds if it never does
+int sinkCost(const Game& g, Player* attacker, const vector<ShipPlacement>& fleet)
+{
+    int limit = g.rows() * g.cols();
+    int shots = attacker == nullptr ? -1 : shotsToSink(g, attacker, fleet.data(), limit);
+    return shots < 0 ? limit + 1 : shots;
+}
+
+  // Play candidate c's half-games against the incumbent for layouts
+  // [first, end).  Layout k is drawn, and each side's shots are chosen,
+  // from generators seeded from (seed, k) alone, the same for every
+  // candidate (common random numbers), so candidates differ only by what
+  // their parameters change.
+void evaluate(const TuneConfig& config, const PlayerParams& incumbent,
+              const vector<vector<ShipPlacement>>& targets, const Candidate& c,
+              long long first, long long end, long long& attackShots, long long& defenseShots)
+{
+    Game g(config.rows, config.cols);
+    addStandardShips(g);
+    vector<ShipPlacement> fleet;
+    for (long long k = first; k < end; k++)
+    {
+        seedRandom(gameSeed(config.seed, k));
+        unique_ptr<Player> attacker(createPlayer(config.type, "candidate", g, c.params));
+        attackShots += sinkCost(g, attacker.get(), targets[k]);
+
+        seedRandom(layoutSeed(config.seed, k));
+        unique_ptr<Player> placer(createPlayer(config.type, "candidate", g, c.params));
+        if (!placeWith(g, placer.get(), fleet))
+            continue;       // a fleet it cannot place defends nothing
+        seedRandom(gameSeed(config.seed ^ 0x3c6ef372fe94f82bULL, k));
+        unique_ptr<Player> defender(createPlayer(config.type, "incumbent", g, incumbent));
+        defenseShots += sinkCost(g, defender.get(), fleet);
+    }
+}
+
+  // Score every unscored candidate, sharing chunks of layouts among the
+  // worker threads
+void scoreAll(const TuneConfig& config, const PlayerParams& incumbent,
+              const vector<vector<ShipPlacement>>& targets, vector<Candidate>& pop,
+              int nThreads)
+{
+    const long long CHUNK = 16;
+    vector<pair<size_t, long long>> work;
+    for (size_t i = 0; i < pop.size(); i++)
+        if (!pop[i].scored)
+            for (long long k = 0; k < config.games; k += CHUNK)
+                work.push_back(make_pair(i, k));
+    atomic<size_t> next(0);
+    mutex popMutex;
+    vector<thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back([&]() {
+            for (size_t w = next++; w < work.size(); w = next++)
+            {
+                const Candidate& c = pop[work[w].first];
+                long long attack = 0;
+                long long defense = 0;
+                long long first = work[w].second;
+                evaluate(config, incumbent, targets, c, first,
+                         min(first + CHUNK, config.games), attack, defense);
+                lock_guard<mutex> lock(popMutex);
+                pop[work[w].first].attackShots += attack;
+                pop[work[w].first].defenseShots += defense;
+            }
+        });
+    for (thread& w : workers)
+        w.join();
+    for (Candidate& c : pop)
+        c.scored = true;
+}
+
+double mutateFraction(double x, mt19937_64& rng)
+{
+    return clamp(x + normal_distribution<double>(0, 0.1)(rng), 0.0, 0.75);
+}
+
+  // Change some of the parameters of type in p at random
+void mutate(const string& type, PlayerParams& p, mt19937_64& rng)
+{
+    bernoulli_distribution coin(1.0 / 3);
+    if (type == "mediocre")
+    {
+        MediocreParams& m = p.mediocre;
+        if (coin(rng))
+            m.crossRadius = clamp(m.crossRadius + uniform_int_distribution<int>(-2, 2)(rng), 1, 9);
+        if (coin(rng))
+            m.blockFraction = mutateFraction(m.blockFraction, rng);
+    }
+    else
+    {
+        GoodParams& gp = p.good;
+        if (coin(rng))
+            gp.paritySpacing = uniform_int_distribution<int>(0, 4)(rng);
+        if (coin(rng))
+        {
+            uniform_int_distribution<int> pos(0, 3);
+            swap(gp.probeOrder[pos(rng)], gp.probeOrder[pos(rng)]);
+        }
+        if (coin(rng))
+            gp.blockFraction = mutateFraction(gp.blockFraction, rng);
+    }
+}
+
+  // Take each parameter of type from a or b at random
+PlayerParams crossover(const string& type, const PlayerParams& a, const PlayerParams& b,
+                       mt19937_64& rng)
+{
+    bernoulli_distribution coin(0.5);
+    PlayerParams child = a;
+    if (type == "mediocre")
+    {
+        if (coin(rng))
+            child.mediocre.crossRadius = b.mediocre.crossRadius;
+        if (coin(rng))
+            child.mediocre.blockFraction = b.mediocre.blockFraction;
+    }
+    else
+    {
+        if (coin(rng))
+            child.good.paritySpacing = b.good.paritySpacing;
+        if (coin(rng))
+            copy(b.good.probeOrder, b.good.probeOrder + 4, child.good.probeOrder);
+        if (coin(rng))
+            child.good.blockFraction = b.good.blockFraction;
+    }
+    return child;
+}
+
+string describe(const string& type, const PlayerParams& params)
+{
+    string s;
+    for (const pair<string, string>& f : paramFields(type, params))
+        s += (s.empty() ? "" : ", ") + f.first.substr(type.size() + 1) + " " + f.second;
+    return s;
+}
+
+}  // namespace
+
+int tuneMain(int argc, char* argv[])
+{
+    TuneConfig config;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for " << arg << endl;
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--type")
+            config.type = value;
+        else if (arg == "--population")
+            config.population = atoi(value.c_str());
+        else if (arg == "--generations")
+            config.generations = atoi(value.c_str());
+        else if (arg == "--games")
+            config.games = atoll(value.c_str());
+        else if (arg == "--seed")
+            config.seed = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads")
+            config.nThreads = atoi(value.c_str());
+        else if (arg == "--rows")
+            config.rows = atoi(value.c_str());
+        else if (arg == "--cols")
+            config.cols = atoi(value.c_str());
+        else if (arg == "--out")
+            config.outPath = value;
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            cerr << "usage: tune [--type good|mediocre] [--population N]"
+                 << " [--generations N] [--games N] [--seed S] [--threads T]"
+                 << " [--rows R] [--cols C] [--out FILE]" << endl;
+            return 2;
+        }
+    }
+    if (config.type != "good"  &&  config.type != "mediocre")
+    {
+        cerr << "--type must be good or mediocre" << endl;
+        return 2;
+    }
+    if (config.population < 2  ||  config.generations < 1  ||  config.games < 1)
+    {
+        cerr << "--population must be >= 2, --generations and --games >= 1" << endl;
+        return 2;
+    }
+    int nThreads = config.nThreads;
+    if (nThreads <= 0)
+        nThreads = max(1u, thread::hardware_concurrency());
+
+      // The candidates are measured against the parameters in force now,
+      // attacking the same fleets placed by the incumbent
+    const PlayerParams incumbent = playerParams();
+    Game g(config.rows, config.cols);
+    addStandardShips(g);
+    vector<vector<ShipPlacement>> targets(config.games);
+    for (long long k = 0; k < config.games; k++)
+    {
+        seedRandom(layoutSeed(config.seed, k));
+        unique_ptr<Player> placer(createPlayer(config.type, "incumbent", g, incumbent));
+        if (!placeWith(g, placer.get(), targets[k]))
+        {
+            cerr << config.type << " could not place layout " << k << endl;
+            return 1;
+        }
+    }
+
+      // A genetic search: the best quarter of each generation survives, and
+      // the rest are replaced by mutated crossings of the survivors
+    mt19937_64 rng(config.seed);
+    vector<Candidate> pop(config.population);
+    for (size_t i = 0; i < pop.size(); i++)
+    {
+        pop[i].params = incumbent;
+        if (i > 0)
+            mutate(config.type, pop[i].params, rng);
+    }
+    size_t nElite = max<size_t>(1, pop.size() / 4);
+    for (int gen = 0; gen < config.generations; gen++)
+    {
+        scoreAll(config, incumbent, targets, pop, nThreads);
+        stable_sort(pop.begin(), pop.end(), [&](const Candidate& a, const Candidate& b) {
+            return a.score(config.games) > b.score(config.games);
+        });
+        const Candidate& best = pop[0];
+        cout << "generation " << gen + 1 << ": " << fixed << setprecision(2)
+             << best.score(config.games) << " shots ahead (attack "
+             << double(best.attackShots) / config.games << ", defense "
+             << double(best.defenseShots) / config.games << "): "
+             << describe(config.type, best.params) << endl;
+        cout.unsetf(ios::floatfield);
+        if (gen + 1 == config.generations)
+            break;
+        uniform_int_distribution<size_t> pick(0, nElite - 1);
+        for (size_t i = nElite; i < pop.size(); i++)
+        {
+            pop[i] = Candidate();
+            pop[i].params = crossover(config.type, pop[pick(rng)].params,
+                                      pop[pick(rng)].params, rng);
+            mutate(config.type, pop[i].params, rng);
+        }
+    }
+
+    if (!writePlayerParams(config.outPath, pop[0].params))
+    {
+        cerr << "Cannot write " << config.outPath << endl;
+        return 1;
+    }
+    cout << "Wrote " << config.outPath << "; load it with BATTLESHIP_PARAMS="
+         << config.outPath << endl;
+    return 0;
+}
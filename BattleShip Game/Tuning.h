@@ -0,0 +1,67 @@
+#ifndef TUNING_INCLUDED
+#define TUNING_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+// The tunable choices of the built-in AI players, and a tuner that searches
+// them by self-play.  The defaults are the choices the players have always
+// made.  A parameters file is line-oriented text:
+//
+//     battleship-params 1
+//     mediocre.crossRadius 4
+//     mediocre.blockFraction 0.5
+//     good.paritySpacing 0
+//     good.probeOrder 3 2 1 0
+//     good.blockFraction 0.5
+//     end
+//
+// Keys may be left out, leaving their defaults.
+
+struct MediocreParams
+{
+      // after a hit, fire within this many cells of it along its row and
+      // column until a ship sinks; 1 to max(MAXROWS, MAXCOLS)
+    int crossRadius = 4;
+      // share of the board blocked at random while placing ships
+    double blockFraction = 0.5;
+};
+
+struct GoodParams
+{
+      // hunt one residue class of r+c modulo this; 0 means the length of
+      // the shortest ship still afloat
+    int paritySpacing = 0;
+      // the order, as directions 0 right, 1 left, 2 down, 3 up, in which
+      // the neighbours of a lone hit are probed
+    int probeOrder[4] = { 3, 2, 1, 0 };
+    double blockFraction = 0.5;
+};
+
+struct PlayerParams
+{
+    MediocreParams mediocre;
+    GoodParams good;
+};
+
+  // The parameters createPlayer gives the built-in players: those loaded
+  // by loadPlayerParamsFromEnv, or the defaults
+const PlayerParams& playerParams();
+
+  // A hash of playerParams(), or 0 if they are the defaults.  Results files
+  // record it, since the parameters change how the players play.
+std::uint64_t playerParamsFingerprint();
+
+bool writePlayerParams(const std::string& path, const PlayerParams& params);
+
+  // On failure, error says why
+bool readPlayerParams(const std::string& path, PlayerParams& params, std::string& error);
+
+  // Load the parameters file named by the BATTLESHIP_PARAMS environment
+  // variable, if any.  Call at startup, before any games run.
+void loadPlayerParamsFromEnv();
+
+  // Entry point for "battleship tune [options]"
+int tuneMain(int argc, char* argv[]);
+
+#endif // TUNING_INCLUDED
@@ -0,0 +1,537 @@
+// Benchmarks for the game engine hot paths.
+//
+//   battleship_bench [--out FILE] [--baseline FILE] [--tolerance FRACTION]
+//                    [--scale FACTOR] [--seed N] [--filter SUBSTRING]
+//
+// Results are written as JSON (to --out, or stdout).  With --baseline, each
+// benchmark is compared against the stored result of the same name and the
+// program exits with status 1 if any is slower by more than the tolerance.
+// Set BATTLESHIP_STATS to also dump the engine's hot-path counters.
+
+#include "Game.h"
+#include "Board.h"
+#include "Player.h"
+#include "globals.h"
+#include "Stats.h"
+#include "Tournament.h"
+#include "Heatmap.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Result
+{
+    string name;
+    long long ops;
+    double nsPerOp;
+};
+
+struct Options
+{
+    string outFile;
+    string baselineFile;
+    double tolerance = 0.25;
+    double scale = 1.0;
+    unsigned int seed = 42;
+    string filter;
+};
+
+using Clock = chrono::steady_clock;
+
+double elapsedNs(Clock::time_point start, Clock::time_point end)
+{
+    return chrono::duration<double, nano>(end - start).count();
+}
+
+volatile long long sink;    // keeps results of timed calls observable
+
+  // A fixed, legal layout so board benchmarks do not depend on the RNG
+void placeFixedFleet(const Game& g, Board& b)
+{
+    b.clear();
+    for (int k = 0; k < g.nShips(); k++)
+        b.placeShip(Point(2 * k, k), k, HORIZONTAL);
+}
+
+const char* const aiTypes[] = { "awful", "mediocre", "good", "heatmap" };
+
+class Suite
+{
+  public:
+    Suite(const Options& opts) : m_opts(opts) {}
+    const vector<Result>& results() const { return m_results; }
+
+    bool wanted(const string& name) const
+    {
+        return m_opts.filter.empty()  ||  name.find(m_opts.filter) != string::npos;
+    }
+
+    long long iterations(long long base) const
+    {
+        long long n = static_cast<long long>(base * m_opts.scale);
+        return n < 1 ? 1 : n;
+    }
+
+    void record(const string& name, long long ops, double totalNs)
+    {
+        m_results.push_back(Result{name, ops, ops > 0 ? totalNs / ops : 0});
+        cerr << "  " << name << ": " << m_results.back().nsPerOp << " ns/op ("
+             << ops << " ops)" << endl;
+    }
+
+    void benchPlaceShip();
+    void benchAttack();
+    void benchAttackBatch();
+    void benchAllShipsDestroyed();
+    void benchMarkRollback();
+    void benchPlaceShips(const string& type);
+    void benchRecommendAttack(const string& type);
+    void benchHeatmap(int size);
+    void benchGames(const string& type1, const string& type2);
+
+  private:
+    const Options& m_opts;
+    vector<Result> m_results;
+};
+
+  // Mirrors the scan in placeAShip: try the patrol boat at every anchor in
+  // both directions on a progressively filling board.
+void Suite::benchPlaceShip()
+{
+    const string name = "board.placeShip";
+    if (!wanted(name))
+        return;
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+    int boat = g.nShips() - 1;
+    long long ops = 0;
+    long long placed = 0;
+    double ns = 0;
+    for (long long n = iterations(20000); n > 0; n--)
+    {
+        b.clear();
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < g.rows(); r++)
+            for (int c = 0; c < g.cols(); c++)
+            {
+                placed += b.placeShip(Point(r, c), boat, HORIZONTAL);
+                placed += b.placeShip(Point(r, c), boat, VERTICAL);
+            }
+        ns += elapsedNs(start, Clock::now());
+        ops += 2 * g.rows() * g.cols();
+    }
+    sink = placed;
+    record(name, ops, ns);
+}
+
+void Suite::benchAttack()
+{
+    const string name = "board.attack";
+    if (!wanted(name))
+        return;
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+    long long ops = 0;
+    long long hits = 0;
+    double ns = 0;
+    for (long long n = iterations(20000); n > 0; n--)
+    {
+        placeFixedFleet(g, b);
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < g.rows(); r++)
+            for (int c = 0; c < g.cols(); c++)
+            {
+                bool shotHit, shipDestroyed;
+                int shipId;
+                b.attack(Point(r, c), shotHit, shipDestroyed, shipId);
+                hits += shotHit;
+            }
+        ns += elapsedNs(start, Clock::now());
+        ops += g.rows() * g.cols();
+    }
+    sink = hits;
+    record(name, ops, ns);
+}
+
+void Suite::benchAttackBatch()
+{
+    const string name = "board.attackBatch";
+    if (!wanted(name))
+        return;
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+      // The whole board as one salvo, so ops are comparable to board.attack
+    vector<Point> shots;
+    for (int r = 0; r < g.rows(); r++)
+        for (int c = 0; c < g.cols(); c++)
+            shots.push_back(Point(r, c));
+    vector<ShotResult> results(shots.size());
+    long long ops = 0;
+    long long valid = 0;
+    double ns = 0;
+    for (long long n = iterations(20000); n > 0; n--)
+    {
+        placeFixedFleet(g, b);
+        Clock::time_point start = Clock::now();
+        valid += b.attackBatch(shots, results);
+        ns += elapsedNs(start, Clock::now());
+        ops += static_cast<long long>(shots.size());
+    }
+    sink = valid;
+    record(name, ops, ns);
+}
+
+void Suite::benchAllShipsDestroyed()
+{
+    const string name = "board.allShipsDestroyed";
+    if (!wanted(name))
+        return;
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+    placeFixedFleet(g, b);
+      // Sink every ship except one cell so each call scans most of the board
+    for (int r = 0; r < g.rows(); r++)
+        for (int c = 0; c < g.cols(); c++)
+        {
+            if (r == g.rows() - 1  &&  c == g.cols() - 1)
+                continue;
+            bool shotHit, shipDestroyed;
+            int shipId;
+            b.attack(Point(r, c), shotHit, shipDestroyed, shipId);
+        }
+    long long ops = iterations(2000000);
+    long long destroyed = 0;
+    Clock::time_point start = Clock::now();
+    for (long long n = 0; n < ops; n++)
+        destroyed += b.allShipsDestroyed();
+    double ns = elapsedNs(start, Clock::now());
+    sink = destroyed;
+    record(name, ops, ns);
+}
+
+  // A lookahead step: open a mark, place the fleet and fire a few shots,
+  // then roll the board back
+void Suite::benchMarkRollback()
+{
+    const string name = "board.markRollback";
+    if (!wanted(name))
+        return;
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+    long long ops = iterations(200000);
+    long long hits = 0;
+    Clock::time_point start = Clock::now();
+    for (long long n = 0; n < ops; n++)
+    {
+        Board::Mark m = b.mark();
+        placeFixedFleet(g, b);
+        for (int c = 0; c < g.cols(); c++)
+        {
+            bool shotHit, shipDestroyed;
+            int shipId;
+            b.attack(Point(0, c), shotHit, shipDestroyed, shipId);
+            hits += shotHit;
+        }
+        b.rollback(m);
+    }
+    double ns = elapsedNs(start, Clock::now());
+    sink = hits;
+    record(name, ops, ns);
+}
+
+void Suite::benchPlaceShips(const string& type)
+{
+    const string name = "player." + type + ".placeShips";
+    if (!wanted(name))
+        return;
+    seedRandom(m_opts.seed);
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+    Player* p = createPlayer(type, type, g);
+    long long ops = iterations(type == "awful" ? 200000 : 20000);
+    long long placed = 0;
+    double ns = 0;
+    for (long long n = 0; n < ops; n++)
+    {
+        b.clear();
+        Clock::time_point start = Clock::now();
+        placed += p->placeShips(b);
+        ns += elapsedNs(start, Clock::now());
+    }
+    sink = placed;
+    delete p;
+    record(name, ops, ns);
+}
+
+  // Each player hunts down a freshly placed fleet; only the
+  // recommendAttack calls are timed.
+void Suite::benchRecommendAttack(const string& type)
+{
+    const string name = "player." + type + ".recommendAttack";
+    if (!wanted(name))
+        return;
+    seedRandom(m_opts.seed);
+    Game g(10, 10);
+    addStandardShips(g);
+    Board b(g);
+    Player* placer = createPlayer("mediocre", "placer", g);
+    long long ops = 0;
+    double ns = 0;
+    for (long long n = iterations(2000); n > 0; n--)
+    {
+        placer->placeShips(b);
+        Player* p = createPlayer(type, type, g);
+        p->setOpponentView(&b.shotView());
+        for (int shot = 0; shot < 4 * g.rows() * g.cols()  &&
+                                            !b.allShipsDestroyed(); shot++)
+        {
+            Clock::time_point start = Clock::now();
+            Point target = p->recommendAttack();
+            ns += elapsedNs(start, Clock::now());
+            ops++;
+            bool shotHit, shipDestroyed;
+            int shipId;
+            bool valid = b.attack(target, shotHit, shipDestroyed, shipId);
+            p->recordAttackResult(target, valid, shotHit, shipDestroyed, shipId);
+        }
+        delete p;
+    }
+    delete placer;
+    record(name, ops, ns);
+}
+
+  // One move of a heatmap player on a size x size board: block the cell
+  // just missed, then find the hottest cell
+void Suite::benchHeatmap(int size)
+{
+    const string name = "heatmap.move" + to_string(size);
+    if (!wanted(name))
+        return;
+    seedRandom(m_opts.seed);
+    Heatmap heat(size, size, { 5, 4, 3, 3, 2 });
+    long long ops = 0;
+    long long found = 0;
+    double ns = 0;
+    for (long long n = iterations(100); n > 0; n--)
+    {
+        int r = randInt(size);
+        int c = randInt(size);
+        Clock::time_point start = Clock::now();
+        heat.block(r, c);
+        int64_t best = -1;
+        for (int i = 0; i < size; i++)
+            for (int j = 0; j < size; j++)
+                if (heat.heat(i, j) > best)
+                {
+                    best = heat.heat(i, j);
+                    found = i * size + j;
+                }
+        ns += elapsedNs(start, Clock::now());
+        ops++;
+    }
+    sink = found;
+    record(name, ops, ns);
+}
+
+void Suite::benchGames(const string& type1, const string& type2)
+{
+    const string name = "game." + type1 + "_vs_" + type2;
+    if (!wanted(name))
+        return;
+    seedRandom(m_opts.seed);
+    long long ops = iterations(2000);
+    long long p1Wins = 0;
+    Clock::time_point start = Clock::now();
+    for (long long k = 0; k < ops; k++)
+    {
+        Game g(10, 10);
+        addStandardShips(g);
+        Player* p1 = createPlayer(type1, type1, g);
+        Player* p2 = createPlayer(type2, type2, g);
+        Player* winner = (k % 2 == 0 ? g.play(p1, p2, false, false)
+                                     : g.play(p2, p1, false, false));
+        if (winner == p1)
+            p1Wins++;
+        delete p1;
+        delete p2;
+    }
+    double ns = elapsedNs(start, Clock::now());
+    sink = p1Wins;
+    record(name, ops, ns);
+}
+
+void writeJson(ostream& out, const Options& opts, const vector<Result>& results)
+{
+    out << "{\n";
+    out << "  \"schema\": 1,\n";
+    out << "  \"seed\": " << opts.seed << ",\n";
+    out << "  \"scale\": " << opts.scale << ",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops
+            << ", \"ns_per_op\": " << r.nsPerOp
+            << ", \"ops_per_sec\": " << (r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0)
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+  // Read the name -> ns_per_op pairs from a file written by writeJson
+bool readBaseline(const string& file, map<string, double>& baseline)
+{
+    ifstream in(file);
+    if (!in)
+        return false;
+    stringstream ss;
+    ss << in.rdbuf();
+    string text = ss.str();
+    const string nameKey = "\"name\": \"";
+    const string nsKey = "\"ns_per_op\": ";
+    size_t pos = 0;
+    while ((pos = text.find(nameKey, pos)) != string::npos)
+    {
+        pos += nameKey.size();
+        size_t end = text.find('"', pos);
+        size_t nsPos = text.find(nsKey, end);
+        if (end == string::npos  ||  nsPos == string::npos)
+            break;
+        baseline[text.substr(pos, end - pos)] =
+                            strtod(text.c_str() + nsPos + nsKey.size(), nullptr);
+        pos = nsPos;
+    }
+    return true;
+}
+
+  // Return the number of benchmarks that regressed
+int compareWithBaseline(const map<string, double>& baseline,
+                        const vector<Result>& results, double tolerance)
+{
+    int regressions = 0;
+    cerr << "Comparison with baseline (tolerance " << tolerance * 100 << "%):"
+         << endl;
+    for (const Result& r : results)
+    {
+        map<string, double>::const_iterator it = baseline.find(r.name);
+        if (it == baseline.end()  ||  it->second <= 0)
+        {
+            cerr << "  " << r.name << ": no baseline" << endl;
+            continue;
+        }
+        double ratio = r.nsPerOp / it->second;
+        bool regressed = ratio > 1 + tolerance;
+        if (regressed)
+            regressions++;
+        cerr << "  " << r.name << ": " << it->second << " -> " << r.nsPerOp
+             << " ns/op (x" << ratio << ")"
+             << (regressed ? "  REGRESSION" : "") << endl;
+    }
+    return regressions;
+}
+
+bool parseArgs(int argc, char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+        string value = argv[++i];
+        if (arg == "--out")
+            opts.outFile = value;
+        else if (arg == "--baseline")
+            opts.baselineFile = value;
+        else if (arg == "--tolerance")
+            opts.tolerance = atof(value.c_str());
+        else if (arg == "--scale")
+            opts.scale = atof(value.c_str());
+        else if (arg == "--seed")
+            opts.seed = static_cast<unsigned int>(strtoul(value.c_str(), nullptr, 10));
+        else if (arg == "--filter")
+            opts.filter = value;
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+    if (!parseArgs(argc, argv, opts))
+    {
+        cerr << "usage: " << argv[0] << " [--out FILE] [--baseline FILE]"
+             << " [--tolerance FRACTION] [--scale FACTOR] [--seed N]"
+             << " [--filter SUBSTRING]" << endl;
+        return 2;
+    }
+
+    Suite suite(opts);
+    cerr << "Running benchmarks:" << endl;
+    suite.benchPlaceShip();
+    suite.benchAttack();
+    suite.benchAttackBatch();
+    suite.benchAllShipsDestroyed();
+    suite.benchMarkRollback();
+    for (const char* type : aiTypes)
+        suite.benchPlaceShips(type);
+    for (const char* type : aiTypes)
+        suite.benchRecommendAttack(type);
+    suite.benchHeatmap(1000);
+    suite.benchGames("awful", "mediocre");
+    suite.benchGames("good", "mediocre");
+    suite.benchGames("good", "good");
+
+    dumpStatsIfRequested();
+
+    if (opts.outFile.empty())
+        writeJson(cout, opts, suite.results());
+    else
+    {
+        ofstream out(opts.outFile);
+        if (!out)
+        {
+            cerr << "Cannot write " << opts.outFile << endl;
+            return 2;
+        }
+        writeJson(out, opts, suite.results());
+    }
+
+    if (!opts.baselineFile.empty())
+    {
+        map<string, double> baseline;
+        if (!readBaseline(opts.baselineFile, baseline))
+        {
+            cerr << "Cannot read baseline " << opts.baselineFile << endl;
+            return 2;
+        }
+        if (compareWithBaseline(baseline, suite.results(), opts.tolerance) > 0)
+            return 1;
+    }
+    return 0;
+}
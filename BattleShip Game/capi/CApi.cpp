@@ -0,0 +1,156 @@
+#include "battleship.h"
+#include "Board.h"
+#include "Game.h"
+#include "Player.h"
+#include "Tournament.h"
+#include "globals.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct bs_engine
+{
+    unique_ptr<Game> game;
+};
+
+namespace {
+
+const char fleetSymbols[] = "ABCDEFGHIJKLMNPQRSTUVWYZ";    // no 'O' or 'X'
+
+  // Reject names createPlayer does not know, and the interactive human
+bool knownAIType(const Game& g, const char* type)
+{
+    if (type == nullptr  ||  string(type) == "human")
+        return false;
+    unique_ptr<Player> p(createPlayer(type, type, g));
+    return p != nullptr;
+}
+
+}  // namespace
+
+extern "C" {
+
+int bs_api_version(void)
+{
+    return BS_API_VERSION;
+}
+
+bs_engine* bs_engine_create(int rows, int cols, const int* ship_lengths,
+                            int n_ships, int* error)
+{
+    int err = 0;
+    if (rows < 1  ||  rows > MAXROWS  ||  cols < 1  ||  cols > MAXCOLS  ||
+        n_ships < 0  ||  (ship_lengths == nullptr  &&  n_ships != 0)  ||
+        n_ships > static_cast<int>(sizeof(fleetSymbols) - 1))
+        err = BS_ERR_ARGUMENT;
+    unique_ptr<bs_engine> engine;
+    if (err == 0)
+    {
+        engine.reset(new bs_engine);
+        engine->game.reset(new Game(rows, cols));
+        bool ok = true;
+        if (ship_lengths == nullptr)
+            ok = addStandardShips(*engine->game);
+        for (int i = 0; ok  &&  i < n_ships; i++)
+            ok = engine->game->addShip(ship_lengths[i], fleetSymbols[i],
+                                       "ship " + to_string(i));
+        if (!ok)
+            err = BS_ERR_FLEET;
+    }
+    if (err != 0)
+    {
+        if (error != nullptr)
+            *error = err;
+        return nullptr;
+    }
+    return engine.release();
+}
+
+void bs_engine_destroy(bs_engine* engine)
+{
+    delete engine;
+}
+
+int bs_play_games(bs_engine* engine, const char* type1, const char* type2,
+                  unsigned long long seed, long long first_game, int n_games,
+                  int n_threads, bs_game_result* results)
+{
+    if (engine == nullptr  ||  n_games < 0  ||  (results == nullptr  &&  n_games > 0))
+        return -BS_ERR_ARGUMENT;
+    Game& g = *engine->game;
+    if (!knownAIType(g, type1)  ||  !knownAIType(g, type2))
+        return -BS_ERR_PLAYER;
+    string t1 = type1;
+    string t2 = type2;
+
+    if (n_threads <= 0)
+        n_threads = max(1u, thread::hardware_concurrency());
+    n_threads = min(n_threads, max(n_games, 1));
+    atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i; (i = next.fetch_add(1)) < n_games; )
+        {
+            GameRecord rec = playSeriesGame(g, t1, t2, seed, first_game + i);
+            results[i].winner = rec.winner;
+            results[i].shots = rec.shots;
+        }
+    };
+    vector<thread> threads;
+    for (int t = 1; t < n_threads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (thread& t : threads)
+        t.join();
+    return n_games;
+}
+
+int bs_recommend_attacks(bs_engine* engine, const char* type,
+                         const bs_state* states, int n_states, bs_point* out)
+{
+    if (engine == nullptr  ||  n_states < 0  ||
+        (n_states > 0  &&  (states == nullptr  ||  out == nullptr)))
+        return -BS_ERR_ARGUMENT;
+    Game& g = *engine->game;
+    if (!knownAIType(g, type))
+        return -BS_ERR_PLAYER;
+    for (int i = 0; i < n_states; i++)
+    {
+        const bs_state& st = states[i];
+        if (st.n_shots < 0  ||  (st.n_shots > 0  &&  st.shots == nullptr))
+            return -BS_ERR_ARGUMENT;
+        seedRandom(st.seed);
+        unique_ptr<Player> p(createPlayer(type, type, g));
+          // There is no board behind a replayed state, so the view is
+          // rebuilt from the shots, guessing which hits each sunk ship
+          // covered
+        ShotView view = {};
+        p->setOpponentView(&view);
+        for (int k = 0; k < st.n_shots; k++)
+        {
+            const bs_shot& s = st.shots[k];
+            Point pt(s.r, s.c);
+            if (s.valid != 0  &&  g.isValid(pt))
+            {
+                if (s.hit != 0)
+                    view.hits.insert(pt);
+                else
+                    view.misses.insert(pt);
+                if (s.sunk != 0  &&  s.ship_id >= 0  &&  s.ship_id < g.nShips())
+                    view.inferSunk(pt, g.shipLength(s.ship_id));
+            }
+            p->recordAttackResult(pt, s.valid != 0, s.hit != 0,
+                                  s.sunk != 0, s.ship_id);
+        }
+        Point rec = p->recommendAttack();
+        out[i].r = rec.r;
+        out[i].c = rec.c;
+    }
+    return n_states;
+}
+
+}  // extern "C"
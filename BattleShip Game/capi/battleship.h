@@ -0,0 +1,102 @@
+/*
+ * battleship.h -- C interface to the Battleship engine (libbattleship).
+ *
+ * Calls are batch oriented so that callers in other languages pay the
+ * crossing cost once per batch rather than once per game or per move.
+ * The ABI is stable within a major version; check bs_api_version() against
+ * BS_API_VERSION before use.
+ */
+
+#ifndef BATTLESHIP_C_INCLUDED
+#define BATTLESHIP_C_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#  if defined(BS_BUILDING_LIBRARY)
+#    define BS_API __declspec(dllexport)
+#  else
+#    define BS_API __declspec(dllimport)
+#  endif
+#else
+#  define BS_API __attribute__((visibility("default")))
+#endif
+
+#define BS_API_VERSION 1
+
+/* Error codes returned (negated) by the functions below */
+#define BS_ERR_ARGUMENT  1      /* null pointer or out-of-range argument */
+#define BS_ERR_PLAYER    2      /* unknown player type */
+#define BS_ERR_FLEET     3      /* fleet rejected by Game::addShip */
+
+typedef struct bs_engine bs_engine;
+
+typedef struct bs_point
+{
+    int r;
+    int c;
+} bs_point;
+
+typedef struct bs_game_result
+{
+    int winner;         /* 1 or 2 for the type that won, 0 if unfinished */
+    int shots;          /* shots fired by the winner */
+} bs_game_result;
+
+/* One shot a player has already made, and what it learned from it */
+typedef struct bs_shot
+{
+    int r;
+    int c;
+    int valid;
+    int hit;
+    int sunk;
+    int ship_id;        /* -1 unless the shot hit */
+} bs_shot;
+
+/* A position to evaluate: the player's own shots so far, in order */
+typedef struct bs_state
+{
+    const bs_shot* shots;
+    int n_shots;
+    unsigned int seed;  /* seeds the player's random choices */
+} bs_state;
+
+BS_API int bs_api_version(void);
+
+/*
+ * Create an engine for a rows x cols board.  ship_lengths lists the fleet;
+ * pass NULL (and n_ships 0) for the standard five-ship fleet.  On failure
+ * returns NULL and, if error is not NULL, stores a BS_ERR_* code there.
+ */
+BS_API bs_engine* bs_engine_create(int rows, int cols, const int* ship_lengths,
+                                   int n_ships, int* error);
+BS_API void bs_engine_destroy(bs_engine* engine);
+
+/*
+ * Play games first_game .. first_game+n_games-1 between type1 and type2
+ * and store the outcome of game first_game+i in results[i].  Each game is
+ * seeded from (seed, game number), so the results do not depend on
+ * n_threads (0 means one per hardware thread).  type1 moves first in the
+ * even-numbered games.  Returns n_games, or a negated BS_ERR_* code.
+ */
+BS_API int bs_play_games(bs_engine* engine, const char* type1, const char* type2,
+                         unsigned long long seed, long long first_game,
+                         int n_games, int n_threads, bs_game_result* results);
+
+/*
+ * For each of the n_states states, replay its shots into a fresh player of
+ * the given type and store the player's next recommendAttack in out[i].
+ * Returns n_states, or a negated BS_ERR_* code.
+ */
+BS_API int bs_recommend_attacks(bs_engine* engine, const char* type,
+                                const bs_state* states, int n_states,
+                                bs_point* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BATTLESHIP_C_INCLUDED */
@@ -1,6 +1,8 @@
 #ifndef GLOBALS_INCLUDED
 #define GLOBALS_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <random>
 
 const int MAXROWS = 10;
@@ -19,15 +21,37 @@ class Point
     int c;
 };
 
+  // Return the calling thread's random number generator
+inline std::mt19937& randomGenerator()
+{
+    thread_local std::mt19937 generator(std::random_device{}());
+    return generator;
+}
+
+  // Reseed the calling thread's generator so a run can be reproduced
+inline void seedRandom(unsigned int seed)
+{
+    randomGenerator().seed(seed);
+}
+
   // Return a uniformly distributed random int from 0 to limit-1
 inline int randInt(int limit)
 {
-    static std::random_device rd;
-    static std::mt19937 generator(rd());
     if (limit < 1)
         limit = 1;
     std::uniform_int_distribution<> distro(0, limit-1);
-    return distro(generator);
+    return distro(randomGenerator());
+}
+
+  // Fold n bytes into a 64-bit FNV-1a hash; chain calls by passing the
+  // previous result as h.  Stable across builds, so hashes may be saved.
+inline std::uint64_t fingerprint(const void* data, std::size_t n,
+                                 std::uint64_t h = 0xcbf29ce484222325ULL)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (std::size_t k = 0; k < n; k++)
+        h = (h ^ p[k]) * 0x100000001b3ULL;
+    return h;
 }
 
 #endif // GLOBALS_INCLUDED
@@ -3,23 +3,48 @@
 #include <iostream>
 #include <string>
 #include "Board.h"
+#include "Layouts.h"
+#include "League.h"
+#include "Occupancy.h"
+#include "Plugins.h"
+#include "Results.h"
+#include "Stats.h"
+#include "Tournament.h"
+#include "Tuning.h"
 
 using namespace std;
 
 
 
 
-bool addStandardShips(Game& g)
+int main(int argc, char* argv[])
 {
-    return g.addShip(5, 'A', "aircraft carrier")  &&
-           g.addShip(4, 'B', "battleship")  &&
-           g.addShip(3, 'D', "destroyer")  &&
-           g.addShip(3, 'S', "submarine")  &&
-           g.addShip(2, 'P', "patrol boat");
-}
+    loadStrategyPluginsFromEnv();
+    loadOccupancyFromEnv();
+    loadPlayerParamsFromEnv();
+
+    if (argc > 1)
+    {
+        string command = argv[1];
+        int status = 2;
+        if (command == "tournament")
+            status = tournamentMain(argc - 1, argv + 1);
+        else if (command == "merge")
+            status = mergeMain(argc - 1, argv + 1);
+        else if (command == "layouts")
+            status = layoutsMain(argc - 1, argv + 1);
+        else if (command == "league")
+            status = leagueMain(argc - 1, argv + 1);
+        else if (command == "occupancy")
+            status = occupancyMain(argc - 1, argv + 1);
+        else if (command == "tune")
+            status = tuneMain(argc - 1, argv + 1);
+        else
+            cerr << "Unknown command " << command << endl;
+        dumpStatsIfRequested();
+        return status;
+    }
 
-int main()
-{
     const int NTRIALS = 200;
 
     cout << "Select one of these choices for an example of the game:" << endl;
@@ -106,6 +131,7 @@ int main()
     {
        cout << "That's not one of the choices." << endl;
     }
+    dumpStatsIfRequested();
 }
 
 
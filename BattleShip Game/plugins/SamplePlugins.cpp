@@ -0,0 +1,138 @@
+// Two example strategies packaged as a plugin (see StrategyPlugin.h).
+// Build the battleship_sample_plugins target and run, e.g.,
+//
+//     BATTLESHIP_PLUGINS=./libbattleship_sample_plugins.so ./battleship tournament --p1 hunter --p2 mediocre
+//
+// The plugin only includes StrategyPlugin.h; it does not link the engine.
+
+#include "StrategyPlugin.h"
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Shooter
+{
+    int rows;
+    int cols;
+    int nShips;
+    vector<int> lengths;
+    int (*randInt)(int);
+    vector<char> shot;              // rows*cols, nonzero once fired at
+    vector<int> targets;            // cells to try next, as r*cols+c
+
+    Shooter(const bs_game_info* g)
+     : rows(g->rows), cols(g->cols), nShips(g->n_ships),
+       lengths(g->ship_lengths, g->ship_lengths + g->n_ships),
+       randInt(g->rand_int), shot(g->rows * g->cols, 0)
+    {}
+
+    bool fresh(int r, int c) const
+    {
+        return r >= 0  &&  r < rows  &&  c >= 0  &&  c < cols  &&
+               !shot[r * cols + c];
+    }
+
+    void randomShot(int* r, int* c)
+    {
+        do
+        {
+            *r = randInt(rows);
+            *c = randInt(cols);
+        } while (!fresh(*r, *c));
+    }
+};
+
+void* create(const bs_game_info* g)
+{
+    return new Shooter(g);
+}
+
+void destroy(void* self)
+{
+    delete static_cast<Shooter*>(self);
+}
+
+  // Place each ship at random, retrying a bounded number of times
+int placeRandomly(void* self, const bs_board_ops* b)
+{
+    Shooter* s = static_cast<Shooter*>(self);
+    for (int attempt = 0; attempt < 50; attempt++)
+    {
+        b->clear(b->board);
+        int k = 0;
+        for ( ; k < s->nShips; k++)
+        {
+            int tries = 0;
+            while (tries < 200  &&
+                   !b->place_ship(b->board, s->randInt(s->rows),
+                                  s->randInt(s->cols), k, s->randInt(2)))
+                tries++;
+            if (tries == 200)
+                break;
+        }
+        if (k == s->nShips)
+            return 1;
+    }
+    return 0;
+}
+
+void randomAttack(void* self, int* r, int* c)
+{
+    static_cast<Shooter*>(self)->randomShot(r, c);
+}
+
+  // Shoot at random until something is hit, then work through the
+  // neighbours of every hit before going back to random shots
+void huntAttack(void* self, int* r, int* c)
+{
+    Shooter* s = static_cast<Shooter*>(self);
+    while (!s->targets.empty())
+    {
+        int cell = s->targets.back();
+        s->targets.pop_back();
+        if (!s->shot[cell])
+        {
+            *r = cell / s->cols;
+            *c = cell % s->cols;
+            return;
+        }
+    }
+    s->randomShot(r, c);
+}
+
+void recordResult(void* self, int r, int c, int validShot, int shotHit,
+                  int shipDestroyed, int shipId)
+{
+    Shooter* s = static_cast<Shooter*>(self);
+    if (!validShot)
+        return;
+    s->shot[r * s->cols + c] = 1;
+    if (shotHit  &&  !shipDestroyed)
+    {
+        const int dr[] = { -1, 1, 0, 0 };
+        const int dc[] = { 0, 0, -1, 1 };
+        for (int d = 0; d < 4; d++)
+            if (s->fresh(r + dr[d], c + dc[d]))
+                s->targets.push_back((r + dr[d]) * s->cols + c + dc[d]);
+    }
+    (void)shipId;
+}
+
+void recordByOpponent(void*, int, int) {}
+
+const bs_strategy strategies[] = {
+    { BS_STRATEGY_ABI_VERSION, "random", create, destroy, placeRandomly,
+      randomAttack, recordResult, recordByOpponent },
+    { BS_STRATEGY_ABI_VERSION, "hunter", create, destroy, placeRandomly,
+      huntAttack, recordResult, recordByOpponent },
+};
+
+}  // namespace
+
+extern "C" BS_PLUGIN_EXPORT const bs_strategy* bs_plugin_strategies(int* count)
+{
+    *count = sizeof(strategies) / sizeof(strategies[0]);
+    return strategies;
+}
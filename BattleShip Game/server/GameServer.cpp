@@ -0,0 +1,510 @@
+#include "GameServer.h"
+#include "Game.h"
+#include "Board.h"
+#include "Player.h"
+#include "Tournament.h"
+#include "globals.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t MAXLINE = 256;         // longer requests drop the connection
+const int MAXEVENTS = 256;
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0  &&  fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+  // Place a fleet for p on b, retrying as Game::play does
+bool placeFleet(Player* p, Board& b)
+{
+    for (int i = 0; i < 50; i++)
+        if (p->placeShips(b))
+            return true;
+    return false;
+}
+
+}  // namespace
+
+  // One client and the game it is playing, if any
+struct GameServer::Connection
+{
+    int fd;
+    uint64_t id;
+    string in;
+    string out;
+    uint32_t events = EPOLLIN;      // what epoll watches for
+    bool closing = false;
+    bool matchPending = false;      // input waits until the match's RESULT
+
+    unique_ptr<Game> game;
+    unique_ptr<Board> clientBoard;
+    unique_ptr<Board> botBoard;
+    unique_ptr<Player> bot;
+
+    void endGame()
+    {
+        bot.reset();
+        botBoard.reset();
+        clientBoard.reset();
+        game.reset();
+    }
+};
+
+GameServer::GameServer()
+ : m_epoll(epoll_create1(EPOLL_CLOEXEC)), m_nListeners(0),
+   m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), m_stopping(false),
+   m_nextConnId(0), m_workersStopping(false)
+{
+    if (m_epoll < 0)
+        cerr << "epoll_create1: " << strerror(errno) << endl;
+    if (m_wakeFd < 0)
+        cerr << "eventfd: " << strerror(errno) << endl;
+    else
+    {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wakeFd;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &ev);
+    }
+    unsigned int nWorkers = max(1u, thread::hardware_concurrency());
+    for (unsigned int i = 0; i < nWorkers; i++)
+        m_workers.emplace_back([this]() { matchWorker(); });
+}
+
+GameServer::~GameServer()
+{
+      // Matches already being played are finished; queued ones are dropped
+    {
+        lock_guard<mutex> lock(m_matchMutex);
+        m_workersStopping = true;
+    }
+    m_matchReady.notify_all();
+    for (thread& w : m_workers)
+        w.join();
+    while (!m_conns.empty())
+        close(m_conns.begin()->first);
+    for (int i = 0; i < m_nListeners; i++)
+        ::close(m_listenFds[i]);
+    if (!m_unixPath.empty())
+        unlink(m_unixPath.c_str());
+    if (m_wakeFd >= 0)
+        ::close(m_wakeFd);
+    if (m_epoll >= 0)
+        ::close(m_epoll);
+}
+
+bool GameServer::addListener(int fd)
+{
+    if (m_nListeners == 2  ||  !setNonBlocking(fd)  ||  listen(fd, SOMAXCONN) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    m_listenFds[m_nListeners++] = fd;
+    return true;
+}
+
+bool GameServer::listenTcp(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        cerr << "bind: " << strerror(errno) << endl;
+        ::close(fd);
+        return false;
+    }
+    return addListener(fd);
+}
+
+bool GameServer::listenUnix(const string& path)
+{
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        cerr << "bind: " << strerror(errno) << endl;
+        ::close(fd);
+        return false;
+    }
+    m_unixPath = path;
+    return addListener(fd);
+}
+
+void GameServer::stop()
+{
+    m_stopping = true;
+}
+
+void GameServer::run()
+{
+    epoll_event events[MAXEVENTS];
+    while (!m_stopping)
+    {
+        int n = epoll_wait(m_epoll, events, MAXEVENTS, 500);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "epoll_wait: " << strerror(errno) << endl;
+            return;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == m_wakeFd)
+            {
+                collectMatches();
+                continue;
+            }
+            if (fd == m_listenFds[0]  ||  (m_nListeners > 1  &&  fd == m_listenFds[1]))
+            {
+                acceptAll(fd);
+                continue;
+            }
+            auto it = m_conns.find(fd);
+            if (it == m_conns.end())
+                continue;
+            Connection& conn = *it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                conn.closing = true;
+            else
+            {
+                if (events[i].events & EPOLLIN)
+                    onReadable(conn);
+                if (!conn.closing  &&  (events[i].events & EPOLLOUT))
+                    flush(conn);
+            }
+            if (conn.closing  &&  (conn.out.empty()  ||  (events[i].events & (EPOLLERR | EPOLLHUP))))
+                close(fd);
+        }
+    }
+}
+
+void GameServer::acceptAll(int listenFd)
+{
+    for (;;)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN  &&  errno != EWOULDBLOCK  &&  errno != EINTR)
+                cerr << "accept: " << strerror(errno) << endl;
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // fails harmlessly on Unix sockets
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        unique_ptr<Connection> conn(new Connection);
+        conn->fd = fd;
+        conn->id = m_nextConnId++;
+        m_conns[fd] = move(conn);
+    }
+}
+
+void GameServer::onReadable(Connection& conn)
+{
+    char buf[4096];
+    for (;;)
+    {
+        ssize_t n = read(conn.fd, buf, sizeof(buf));
+        if (n > 0)
+        {
+            conn.in.append(buf, n);
+              // Refuse an unterminated line as soon as it is too long, so
+              // a client can never make us buffer more than a line's worth
+            size_t nl = conn.in.rfind('\n');
+            size_t tail = (nl == string::npos ? conn.in.size() : conn.in.size() - nl - 1);
+            if (tail > MAXLINE)
+            {
+                conn.in.clear();
+                conn.out += "ERR line too long\n";
+                conn.closing = true;
+                break;
+            }
+            continue;
+        }
+        if (n == 0)
+            conn.closing = true;
+        else if (errno != EAGAIN  &&  errno != EWOULDBLOCK  &&  errno != EINTR)
+            conn.closing = true;
+        break;
+    }
+    processInput(conn);
+    flush(conn);
+}
+
+  // Handle the complete lines buffered for conn, stopping at a MATCH until
+  // its result is in
+void GameServer::processInput(Connection& conn)
+{
+    size_t start = 0;
+    size_t nl;
+    while (!conn.closing  &&  !conn.matchPending  &&
+           (nl = conn.in.find('\n', start)) != string::npos)
+    {
+        string line = conn.in.substr(start, nl - start);
+        if (!line.empty()  &&  line.back() == '\r')
+            line.pop_back();
+        start = nl + 1;
+        handleLine(conn, line);
+    }
+    conn.in.erase(0, start);
+}
+
+  // Write as much pending output as the socket takes; watch for
+  // writability only while output is backed up, and for input only while
+  // no match is pending.
+bool GameServer::flush(Connection& conn)
+{
+    size_t done = 0;
+    while (done < conn.out.size())
+    {
+        ssize_t n = write(conn.fd, conn.out.data() + done, conn.out.size() - done);
+        if (n > 0)
+            done += n;
+        else if (n < 0  &&  errno == EINTR)
+            continue;
+        else if (n < 0  &&  (errno == EAGAIN  ||  errno == EWOULDBLOCK))
+            break;
+        else
+        {
+            conn.out.clear();
+            conn.closing = true;
+            return false;
+        }
+    }
+    conn.out.erase(0, done);
+    uint32_t events = (conn.matchPending ? 0u : uint32_t(EPOLLIN)) |
+                      (conn.out.empty() ? 0u : uint32_t(EPOLLOUT));
+    if (events != conn.events)
+    {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = conn.fd;
+        epoll_ctl(m_epoll, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.events = events;
+    }
+    return true;
+}
+
+void GameServer::close(int fd)
+{
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_conns.erase(fd);
+}
+
+void GameServer::handleLine(Connection& conn, const string& line)
+{
+    istringstream iss(line);
+    string cmd;
+    iss >> cmd;
+    if (cmd.empty())
+        return;
+
+    if (cmd == "NEW")
+    {
+        string type;
+        if (!(iss >> type)  ||  type == "human")
+        {
+            conn.out += "ERR usage: NEW <type>\n";
+            return;
+        }
+        conn.endGame();
+        conn.game.reset(new Game(10, 10));
+        addStandardShips(*conn.game);
+        conn.bot.reset(createPlayer(type, type, *conn.game));
+        if (conn.bot == nullptr)
+        {
+            conn.endGame();
+            conn.out += "ERR unknown player type\n";
+            return;
+        }
+        conn.clientBoard.reset(new Board(*conn.game));
+        conn.botBoard.reset(new Board(*conn.game));
+        unique_ptr<Player> placer(createPlayer("good", "placer", *conn.game));
+        if (!placeFleet(conn.bot.get(), *conn.botBoard)  ||
+            !placeFleet(placer.get(), *conn.clientBoard))
+        {
+            conn.endGame();
+            conn.out += "ERR cannot place fleets\n";
+            return;
+        }
+        conn.bot->setOpponentView(&conn.clientBoard->shotView());
+        conn.out += "OK 10 10 " + to_string(conn.game->nShips()) + "\n";
+    }
+    else if (cmd == "FIRE")
+    {
+        int r, c;
+        if (!(iss >> r >> c))
+        {
+            conn.out += "ERR usage: FIRE <r> <c>\n";
+            return;
+        }
+        if (conn.game == nullptr)
+        {
+            conn.out += "ERR no game\n";
+            return;
+        }
+        bool hit, sunk;
+        int shipId;
+        Point p(r, c);
+        bool valid = conn.botBoard->attack(p, hit, sunk, shipId);
+        conn.bot->recordAttackByOpponent(p);
+        conn.out += "SHOT " + to_string(r) + " " + to_string(c) + " " +
+                    to_string(valid) + " " + to_string(hit) + " " +
+                    to_string(sunk) + " " + to_string(shipId) + "\n";
+        if (conn.botBoard->allShipsDestroyed())
+        {
+            conn.out += "WIN\n";
+            conn.endGame();
+            return;
+        }
+        Point q = conn.bot->recommendAttack();
+        valid = conn.clientBoard->attack(q, hit, sunk, shipId);
+        conn.bot->recordAttackResult(q, valid, hit, sunk, shipId);
+        bool lost = conn.clientBoard->allShipsDestroyed();
+        conn.out += (lost ? "LOSE " : "BOT ") + to_string(q.r) + " " +
+                    to_string(q.c) + " " + to_string(valid) + " " +
+                    to_string(hit) + " " + to_string(sunk) + " " +
+                    to_string(shipId) + "\n";
+        if (lost)
+            conn.endGame();
+    }
+    else if (cmd == "MATCH")
+    {
+        string t1, t2;
+        unsigned int seed;
+        if (!(iss >> t1 >> t2 >> seed)  ||  t1 == "human"  ||  t2 == "human")
+        {
+            conn.out += "ERR usage: MATCH <type1> <type2> <seed>\n";
+            return;
+        }
+          // A whole game can take long, or forever with a bad plugin
+          // strategy, so it is played off the epoll thread
+        conn.matchPending = true;
+        {
+            lock_guard<mutex> lock(m_matchMutex);
+            m_matchQueue.push_back(Match{ conn.fd, conn.id, t1, t2, seed, string() });
+        }
+        m_matchReady.notify_one();
+    }
+    else if (cmd == "QUIT")
+        conn.closing = true;
+    else
+        conn.out += "ERR unknown command\n";
+}
+
+void GameServer::matchWorker()
+{
+    for (;;)
+    {
+        Match m;
+        {
+            unique_lock<mutex> lock(m_matchMutex);
+            m_matchReady.wait(lock, [this]() { return m_workersStopping  ||  !m_matchQueue.empty(); });
+            if (m_workersStopping)
+                return;
+            m = move(m_matchQueue.front());
+            m_matchQueue.pop_front();
+        }
+
+          // Seeds this worker's own generator, not the epoll thread's
+        seedRandom(m.seed);
+        Game g(10, 10);
+        addStandardShips(g);
+        unique_ptr<Player> p1(createPlayer(m.type1, m.type1, g));
+        unique_ptr<Player> p2(createPlayer(m.type2, m.type2, g));
+        if (p1 == nullptr  ||  p2 == nullptr)
+            m.reply = "ERR unknown player type\n";
+        else
+        {
+            Player* winner = g.play(p1.get(), p2.get(), false, false);
+            m.reply = string("RESULT ") +
+                      (winner == p1.get() ? "1" : winner == p2.get() ? "2" : "0") + "\n";
+        }
+
+        {
+            lock_guard<mutex> lock(m_matchMutex);
+            m_matchesDone.push_back(move(m));
+        }
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0  &&  errno != EAGAIN)
+            cerr << "eventfd write: " << strerror(errno) << endl;
+    }
+}
+
+  // Deliver the results of finished matches and resume their connections
+void GameServer::collectMatches()
+{
+    uint64_t count;
+    while (read(m_wakeFd, &count, sizeof(count)) > 0)
+        ;
+    vector<Match> done;
+    {
+        lock_guard<mutex> lock(m_matchMutex);
+        done.swap(m_matchesDone);
+    }
+    for (const Match& m : done)
+    {
+          // The client may have gone, and its descriptor been reused
+        auto it = m_conns.find(m.fd);
+        if (it == m_conns.end()  ||  it->second->id != m.connId)
+            continue;
+        Connection& conn = *it->second;
+        conn.out += m.reply;
+        conn.matchPending = false;
+        processInput(conn);
+        flush(conn);
+        if (conn.closing  &&  conn.out.empty())
+            close(m.fd);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef GAMESERVER_INCLUDED
+#define GAMESERVER_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// An epoll-driven server that hosts one game per client connection over
+// TCP or a Unix-domain socket.  Interactive games are played on the epoll
+// thread; whole bot-vs-bot matches go to a pool of worker threads.  The
+// protocol is line based; every request line gets one or more reply lines,
+// in request order:
+//
+//   NEW <type>             start a game against a <type> bot on a 10x10
+//                          board with the standard fleet; the server places
+//                          the client's fleet too
+//                            -> OK <rows> <cols> <nShips>
+//   FIRE <r> <c>           shoot at the bot's board; the bot answers at once
+//                            -> SHOT <r> <c> <valid> <hit> <sunk> <shipId>
+//                               then one of
+//                               WIN                   (you sank the fleet)
+//                               BOT <r> <c> <valid> <hit> <sunk> <shipId>
+//                               LOSE <r> <c> <valid> <hit> <sunk> <shipId>
+//                               where BOT and LOSE report the bot's shot, and
+//                               LOSE means it sank your last ship
+//   MATCH <t1> <t2> <seed> play a whole bot-vs-bot game on a worker thread;
+//                          the connection's later requests wait for it
+//                            -> RESULT <1|2|0>   (0: nobody could place)
+//   QUIT                   close the connection
+//
+// Malformed or out-of-order requests get "ERR <reason>".
+
+class GameServer
+{
+  public:
+    GameServer();
+    ~GameServer();
+
+      // Listen on 127.0.0.1:port, or on a Unix-domain socket at path
+    bool listenTcp(int port);
+    bool listenUnix(const std::string& path);
+
+      // Serve until stop() is called (from a signal handler is fine)
+    void run();
+    void stop();
+
+    int nConnections() const { return static_cast<int>(m_conns.size()); }
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+  private:
+    struct Connection;
+    struct Match
+    {
+        int fd;
+        std::uint64_t connId;       // tells a reused descriptor apart
+        std::string type1;
+        std::string type2;
+        unsigned int seed;
+        std::string reply;          // filled in by the worker
+    };
+
+    bool addListener(int fd);
+    void acceptAll(int listenFd);
+    void onReadable(Connection& conn);
+    void processInput(Connection& conn);
+    bool flush(Connection& conn);
+    void close(int fd);
+    void handleLine(Connection& conn, const std::string& line);
+    void matchWorker();
+    void collectMatches();
+
+    int m_epoll;
+    int m_listenFds[2];
+    int m_nListeners;
+    int m_wakeFd;                   // eventfd the workers signal when a match is done
+    std::string m_unixPath;
+    std::atomic<bool> m_stopping;
+    std::uint64_t m_nextConnId;
+    std::unordered_map<int, std::unique_ptr<Connection>> m_conns;
+
+    std::mutex m_matchMutex;        // guards the three members below
+    std::condition_variable m_matchReady;
+    std::deque<Match> m_matchQueue;
+    std::vector<Match> m_matchesDone;
+    bool m_workersStopping;
+    std::vector<std::thread> m_workers;
+};
+
+#endif // GAMESERVER_INCLUDED
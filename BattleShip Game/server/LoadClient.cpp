@@ -0,0 +1,276 @@
+// battleship_loadclient (--tcp PORT | --unix PATH) [--conns N] [--games G]
+//                       [--bot TYPE] [--match]
+//
+// Stand-in for remote players when load testing battleship_server.  Opens N
+// connections at once and on each plays G games against a TYPE bot, firing
+// at the cells in a random order.  With --match each game is instead a
+// server-side bot-vs-bot MATCH.  Prints throughput when all games are done.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+struct Options
+{
+    int port = -1;
+    string unixPath;
+    int nConns = 1000;
+    int gamesPerConn = 10;
+    string bot = "mediocre";
+    bool match = false;
+};
+
+struct Client
+{
+    int fd = -1;
+    string in;
+    string out;
+    int gamesLeft = 0;
+    vector<int> shots;          // cells still to fire at, in firing order
+    size_t nextShot = 0;
+    unsigned int seed = 0;
+};
+
+int connectTo(const Options& opts)
+{
+    int fd;
+    if (opts.port >= 0)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(opts.port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0  &&  connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+    }
+    else
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, opts.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd >= 0  &&  connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+    }
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+  // Queue the request that starts the client's next game
+void startGame(Client& c, const Options& opts, mt19937& rng)
+{
+    if (opts.match)
+    {
+        c.out += "MATCH good " + opts.bot + " " + to_string(c.seed++) + "\n";
+        return;
+    }
+    c.shots.resize(100);
+    for (int i = 0; i < 100; i++)
+        c.shots[i] = i;
+    shuffle(c.shots.begin(), c.shots.end(), rng);
+    c.nextShot = 0;
+    c.out += "NEW " + opts.bot + "\n";
+}
+
+void fire(Client& c)
+{
+    int cell = c.shots[c.nextShot++ % c.shots.size()];
+    c.out += "FIRE " + to_string(cell / 10) + " " + to_string(cell % 10) + "\n";
+}
+
+  // React to one reply line; returns false on a protocol error
+bool handleReply(Client& c, const string& line, const Options& opts,
+                 mt19937& rng, long long& requests)
+{
+    if (line.compare(0, 3, "ERR") == 0)
+    {
+        cerr << "server: " << line << endl;
+        return false;
+    }
+    bool gameOver = line.compare(0, 3, "WIN") == 0  ||
+                    line.compare(0, 4, "LOSE") == 0  ||
+                    line.compare(0, 6, "RESULT") == 0;
+    if (gameOver)
+    {
+        c.gamesLeft--;
+        if (c.gamesLeft > 0)
+        {
+            startGame(c, opts, rng);
+            requests++;
+        }
+    }
+    else if (line.compare(0, 2, "OK") == 0  ||  line.compare(0, 3, "BOT") == 0)
+    {
+        fire(c);
+        requests++;
+    }
+    return true;
+}
+
+bool parseArgs(int argc, char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--match")
+        {
+            opts.match = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        string value = argv[++i];
+        if (arg == "--tcp")
+            opts.port = atoi(value.c_str());
+        else if (arg == "--unix")
+            opts.unixPath = value;
+        else if (arg == "--conns")
+            opts.nConns = atoi(value.c_str());
+        else if (arg == "--games")
+            opts.gamesPerConn = atoi(value.c_str());
+        else if (arg == "--bot")
+            opts.bot = value;
+        else
+            return false;
+    }
+    return (opts.port >= 0  ||  !opts.unixPath.empty())  &&
+           opts.nConns > 0  &&  opts.gamesPerConn > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+    if (!parseArgs(argc, argv, opts))
+    {
+        cerr << "usage: " << argv[0] << " (--tcp PORT | --unix PATH) [--conns N]"
+             << " [--games G] [--bot TYPE] [--match]" << endl;
+        return 2;
+    }
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    mt19937 rng(12345);
+    int epfd = epoll_create1(0);
+    vector<Client> clients(opts.nConns);
+    long long requests = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < opts.nConns; i++)
+    {
+        Client& c = clients[i];
+        c.fd = connectTo(opts);
+        if (c.fd < 0)
+        {
+            cerr << "Connection " << i << " failed: " << strerror(errno) << endl;
+            return 1;
+        }
+        c.gamesLeft = opts.gamesPerConn;
+        c.seed = static_cast<unsigned int>(i) * opts.gamesPerConn;
+        startGame(c, opts, rng);
+        requests++;
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = i;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    int active = opts.nConns;
+    vector<epoll_event> events(256);
+    char buf[4096];
+    while (active > 0)
+    {
+        int n = epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 5000);
+        if (n <= 0)
+        {
+            if (n < 0  &&  errno == EINTR)
+                continue;
+            cerr << "Timed out waiting for the server" << endl;
+            return 1;
+        }
+        for (int k = 0; k < n; k++)
+        {
+            Client& c = clients[events[k].data.u32];
+            if (c.fd < 0)
+                continue;
+            bool failed = (events[k].events & (EPOLLERR | EPOLLHUP)) != 0;
+            if (!failed  &&  (events[k].events & EPOLLIN))
+            {
+                ssize_t got;
+                while ((got = read(c.fd, buf, sizeof(buf))) > 0)
+                    c.in.append(buf, got);
+                if (got == 0)
+                    failed = c.gamesLeft > 0;
+                size_t pos = 0, nl;
+                while (!failed  &&  (nl = c.in.find('\n', pos)) != string::npos)
+                {
+                    failed = !handleReply(c, c.in.substr(pos, nl - pos), opts, rng, requests);
+                    pos = nl + 1;
+                }
+                c.in.erase(0, pos);
+            }
+            if (!failed  &&  !c.out.empty())
+            {
+                ssize_t put = write(c.fd, c.out.data(), c.out.size());
+                if (put > 0)
+                    c.out.erase(0, put);
+                else if (put < 0  &&  errno != EAGAIN)
+                    failed = true;
+            }
+            if (failed)
+            {
+                cerr << "Connection " << events[k].data.u32 << " failed" << endl;
+                return 1;
+            }
+            epoll_event ev = {};
+            ev.events = EPOLLIN | (c.out.empty() ? 0u : uint32_t(EPOLLOUT));
+            ev.data.u32 = events[k].data.u32;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+            if (c.gamesLeft == 0)
+            {
+                ::close(c.fd);
+                c.fd = -1;
+                active--;
+            }
+        }
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long games = static_cast<long long>(opts.nConns) * opts.gamesPerConn;
+    cout << "{\"connections\": " << opts.nConns << ", \"games\": " << games
+         << ", \"requests\": " << requests << ", \"seconds\": " << secs
+         << ", \"games_per_sec\": " << games / secs
+         << ", \"requests_per_sec\": " << requests / secs << "}" << endl;
+    ::close(epfd);
+    return 0;
+}
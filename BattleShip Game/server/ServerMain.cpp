@@ -0,0 +1,86 @@
+// battleship_server [--tcp PORT] [--unix PATH]
+//
+// Hosts games over the line protocol described in GameServer.h until
+// interrupted.
+
+#include "GameServer.h"
+#include "Occupancy.h"
+#include "Plugins.h"
+#include "Tuning.h"
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+
+GameServer* theServer = nullptr;
+
+void onSignal(int)
+{
+    if (theServer != nullptr)
+        theServer->stop();
+}
+
+  // Each game is a connection, so allow as many descriptors as we may
+void raiseDescriptorLimit()
+{
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0  &&  lim.rlim_cur < lim.rlim_max)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    int port = -1;
+    string unixPath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string arg = argv[i];
+        if (arg == "--tcp")
+            port = atoi(argv[i + 1]);
+        else if (arg == "--unix")
+            unixPath = argv[i + 1];
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            return 2;
+        }
+    }
+    if (argc % 2 == 0  ||  (port < 0  &&  unixPath.empty()))
+    {
+        cerr << "usage: " << argv[0] << " [--tcp PORT] [--unix PATH]" << endl;
+        return 2;
+    }
+    loadStrategyPluginsFromEnv();
+    loadOccupancyFromEnv();
+    loadPlayerParamsFromEnv();
+
+    raiseDescriptorLimit();
+    signal(SIGPIPE, SIG_IGN);
+    GameServer server;
+    if (port >= 0  &&  !server.listenTcp(port))
+    {
+        cerr << "Cannot listen on port " << port << endl;
+        return 1;
+    }
+    if (!unixPath.empty()  &&  !server.listenUnix(unixPath))
+    {
+        cerr << "Cannot listen on " << unixPath << endl;
+        return 1;
+    }
+    theServer = &server;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    server.run();
+    theServer = nullptr;
+    return 0;
+}